@@ -20,6 +20,7 @@
 *  [x] Rotate each section of the Magic Cube
 *  [x] Draw & Control whole Magic Cube
 *  [.] Apply texture on the cube
+*  [x] Solve the Magic Cube (two-phase solver)
 *  --- May be more features ?
 */
 #define STB_IMAGE_IMPLEMENTATION
@@ -35,16 +36,35 @@
 
 #include <iostream>
 #include <fstream>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <random>
 #include <string>
+#include <vector>
 #include "source/shaderLoader.h"
 #include "source/cameraSystem.h"
+#include "source/cubeState.h"
+#include "source/stickerMesh.h"
+#include "source/commandQueue.h"
+#include "source/moveAnimator.h"
+#include "source/twoPhaseSolver.h"
+#include "source/solverBenchmark.h"
+#include "source/batchSolver.h"
+#include "source/moveSequence.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow* window);
-void indexRedefine();
+void refresh_callback(GLFWwindow* window);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void processInput();
+template<int N> void startSolve(const Cube<N>& state);
+void collectSolution();
+void indexRedefine(const CubeMove& move);
+void batchRedefine(const CubeMove* moves, size_t count);
 
 // settings
 unsigned int windowWidth = 800, windowHeight = 600;
@@ -55,130 +75,131 @@ float lastX = windowWidth / 2.0f;
 float lastY = windowHeight / 2.0f;
 bool firstMouse = true;
 
+// input commands, recorded by key_callback the moment a key is pressed and drained by processInput
+enum commandType
+{
+    SELECT_SECTION,     // axis & slice, axis < 0 clears the selection
+    STEP_SECTION,       // slice holds the step, +1 or -1
+    TURN_SECTION,       // dir holds the rotate direction
+    TURN_WIDE,          // turn the editing slice together with the slices out to the nearest face
+    TURN_CUBE,          // turn every slice of the editing axis
+    SCRAMBLE_CUBE,      // queue SCRAMBLE_LENGTH random moves
+    TOGGLE_TURBO,       // switch between animating every move & animating only the tail of the queue
+    SOLVE_CUBE          // solve the cube on a worker thread, the solution is queued for playback
+};
+struct InputCommand
+{
+    commandType type;
+    int axis;
+    int slice;
+    int dir;
+    double time;        // glfwGetTime() when the key was pressed
+};
+CommandQueue<InputCommand, 256> inputQueue;
+// camera movement keys held down (forward, backward, left, right) & fast movement modifier
+bool movementHeld[4] = { false, false, false, false };
+bool fastMovement = false;
+
+// render on demand: set whenever something visible changed, otherwise the loop sleeps in glfwWaitEvents
+bool frameDirty = true;
+
 // timing
 float deltaTime = 0.0f;	// time between current frame and last frame
 float lastFrame = 0.0f;
 
+// cube order, the whole magic cube keeps the same size whatever the order is
+const int CUBE_ORDER = 3;
+
 // model data
-const float halfSideLen = 0.1f;
-const float sideLen = halfSideLen * 2;
+const float sideLen = 0.6f / CUBE_ORDER;
+const float halfSideLen = sideLen / 2;
+// unit quad of a single sticker, the vertex shader places it on the right face of the cubie
 const float vertices[] = {
-    // back face 
-    -halfSideLen, -halfSideLen, -halfSideLen,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f,
-     halfSideLen, -halfSideLen, -halfSideLen,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f,
-     halfSideLen,  halfSideLen, -halfSideLen,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f,
-     halfSideLen,  halfSideLen, -halfSideLen,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f,
-    -halfSideLen,  halfSideLen, -halfSideLen,  0.0f,  0.0f, -1.0f, 0.0f, 1.0f,
-    -halfSideLen, -halfSideLen, -halfSideLen,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f,
-    // front face 
-    -halfSideLen, -halfSideLen,  halfSideLen,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f,
-     halfSideLen, -halfSideLen,  halfSideLen,  0.0f,  0.0f,  1.0f, 1.0f, 0.0f,
-     halfSideLen,  halfSideLen,  halfSideLen,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f,
-     halfSideLen,  halfSideLen,  halfSideLen,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f,
-    -halfSideLen,  halfSideLen,  halfSideLen,  0.0f,  0.0f,  1.0f, 0.0f, 1.0f,
-    -halfSideLen, -halfSideLen,  halfSideLen,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f,
-    // left face 
-    -halfSideLen,  halfSideLen,  halfSideLen, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f,
-    -halfSideLen,  halfSideLen, -halfSideLen, -1.0f,  0.0f,  0.0f, 1.0f, 1.0f,
-    -halfSideLen, -halfSideLen, -halfSideLen, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f,
-    -halfSideLen, -halfSideLen, -halfSideLen, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f,
-    -halfSideLen, -halfSideLen,  halfSideLen, -1.0f,  0.0f,  0.0f, 0.0f, 0.0f,
-    -halfSideLen,  halfSideLen,  halfSideLen, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f,
-    // right face 
-     halfSideLen,  halfSideLen,  halfSideLen,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f,
-     halfSideLen,  halfSideLen, -halfSideLen,  1.0f,  0.0f,  0.0f, 1.0f, 1.0f,
-     halfSideLen, -halfSideLen, -halfSideLen,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f,
-     halfSideLen, -halfSideLen, -halfSideLen,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f,
-     halfSideLen, -halfSideLen,  halfSideLen,  1.0f,  0.0f,  0.0f, 0.0f, 0.0f,
-     halfSideLen,  halfSideLen,  halfSideLen,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f,
-     // bottom face 
-    -halfSideLen, -halfSideLen, -halfSideLen,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f,
-     halfSideLen, -halfSideLen, -halfSideLen,  0.0f, -1.0f,  0.0f, 1.0f, 1.0f,
-     halfSideLen, -halfSideLen,  halfSideLen,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f,
-     halfSideLen, -halfSideLen,  halfSideLen,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f,
-    -halfSideLen, -halfSideLen,  halfSideLen,  0.0f, -1.0f,  0.0f, 0.0f, 0.0f,
-    -halfSideLen, -halfSideLen, -halfSideLen,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f,
-    // top face 
-    -halfSideLen,  halfSideLen, -halfSideLen,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f,
-     halfSideLen,  halfSideLen, -halfSideLen,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f,
-     halfSideLen,  halfSideLen,  halfSideLen,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f,
-     halfSideLen,  halfSideLen,  halfSideLen,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f,
-    -halfSideLen,  halfSideLen,  halfSideLen,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f,
-    -halfSideLen,  halfSideLen, -halfSideLen,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f
+    // corner / texture coord
+    0.0f, 0.0f,
+    1.0f, 0.0f,
+    1.0f, 1.0f,
+    1.0f, 1.0f,
+    0.0f, 1.0f,
+    0.0f, 0.0f
 };
 
 // model movement
 const float ANGULAR_SPEED = 50.0f;
-
-// world space positions of our cubes
-const glm::vec3 cubeOriginPositions[] = {
-    // layer 0
-    // // slice 0
-    glm::vec3(-sideLen, -sideLen, -sideLen),
-    glm::vec3( 0.0f, -sideLen, -sideLen),
-    glm::vec3( sideLen, -sideLen, -sideLen),
-    // // slice 1
-    glm::vec3(-sideLen, -sideLen,  0.0f),
-    glm::vec3( 0.0f, -sideLen,  0.0f),
-    glm::vec3( sideLen, -sideLen,  0.0f),
-    // // slice 2
-    glm::vec3(-sideLen, -sideLen,  sideLen),
-    glm::vec3( 0.0f, -sideLen,  sideLen),
-    glm::vec3( sideLen, -sideLen,  sideLen),
-    // layer 1
-    // // slice 0
-    glm::vec3(-sideLen,  0.0f, -sideLen),
-    glm::vec3( 0.0f,  0.0f, -sideLen),
-    glm::vec3( sideLen,  0.0f, -sideLen),
-    // // slice 1
-    glm::vec3(-sideLen,  0.0f,  0.0f),
-    glm::vec3( 0.0f,  0.0f,  0.0f),
-    glm::vec3( sideLen,  0.0f,  0.0f),
-    // // slice 2
-    glm::vec3(-sideLen,  0.0f,  sideLen),
-    glm::vec3( 0.0f,  0.0f,  sideLen),
-    glm::vec3( sideLen,  0.0f,  sideLen),
-    // layer 2
-    // // slice 0
-    glm::vec3(-sideLen,  sideLen, -sideLen),
-    glm::vec3( 0.0f,  sideLen, -sideLen),
-    glm::vec3( sideLen,  sideLen, -sideLen),
-    // // slice 1
-    glm::vec3(-sideLen,  sideLen,  0.0f),
-    glm::vec3( 0.0f,  sideLen,  0.0f),
-    glm::vec3( sideLen,  sideLen,  0.0f),
-    // // slice 2
-    glm::vec3(-sideLen,  sideLen,  sideLen),
-    glm::vec3( 0.0f,  sideLen,  sideLen),
-    glm::vec3( sideLen,  sideLen,  sideLen),
-};
+// longest wall-clock time playing back the queued moves may take, in seconds
+const float PLAYBACK_BUDGET = 10.0f;
+// moves of a random scramble
+const int SCRAMBLE_LENGTH = 100;
 
 // model matrixs
-glm::mat4 cubeModel[27];
-int index[3][3][3] = { 0 };
+// a cubie's model matrix is rebuilt from its slot & orientation index, so turns never accumulate float error
+glm::mat4 rotationModel[CubeRotation::COUNT];
+// logical puzzle state, the renderer only reads it
+Cube<CUBE_ORDER> cubeState;
 
-enum editSection
+// visible stickers of the surface cubies
+StickerMesh stickerMesh(CUBE_ORDER);
+
+// per-instance data, one entry for each sticker, only uploaded again when a turn completes
+// packed into 4 bytes: grid cell of the cubie, orientation index (low 5 bits) & face (high 3 bits)
+struct StickerInstance
 {
-    NONE = 0,
-    Y_BOTTOM_SECTION = 1,
-    Y_MIDDLE_SECTION = 2,
-    Y_TOP_SECTION = 3,
-    Z_BACK_SECTION = 4,
-    Z_MIDDLE_SECTION = 8,
-    Z_FRONT_SECTION = 12,
-    X_LEFT_SECTION = 16,
-    X_MIDDLE_SECTION = 32,
-    X_RIGHT_SECTION = 48
+    int8_t cell[3];
+    uint8_t pose;
+};
+static_assert(sizeof(StickerInstance) == 4, "sticker instance must stay 4 bytes");
+std::vector<StickerInstance> stickerInstances(stickerMesh.stickerCount);
+bool instancesDirty = true;
+
+// the section being edited, axis < 0 means none
+struct EditSection
+{
+    int axis;
+    int slice;
 }nowEditing;
 enum rotateDirection
 {
     STOP = 0,
     CLOCK = 1,
     CONTC = -1
-}nowRotate;
+};
+// queued & running turns
+MoveAnimator animator(90.0f / ANGULAR_SPEED, 0.02, PLAYBACK_BUDGET);
+// solve running on a worker thread, frame is the core rotation of the solved state
+struct SolveTask
+{
+    std::future<TwoPhaseSolver::Result> result;
+    int frame;
+}solveTask;
 
-int main()
+int main(int argc, char* argv[])
 {
+    // headless modes, no window
+    // -------------------------
+    if (argc > 1 && std::string(argv[1]) == "--benchmark")
+        return runSolverBenchmark(std::cout);
+    // --batch [--optimal] [--threads N]: solve the scrambles on stdin, one per line
+    if (argc > 1 && std::string(argv[1]) == "--batch")
+    {
+        int threads = 0;
+        bool optimal = false;
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string option = argv[i];
+            if (option == "--optimal")
+                optimal = true;
+            else if (option == "--threads" && i + 1 < argc)
+                threads = std::atoi(argv[++i]);
+            else
+            {
+                std::cerr << "ERROR::BATCH::UNKNOWN_OPTION <" << option << ">" << std::endl;
+                return -1;
+            }
+        }
+        std::ios::sync_with_stdio(false);
+        return runBatchSolver(std::cin, std::cout, threads, optimal) != 0;
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -203,6 +224,8 @@ int main()
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetWindowRefreshCallback(window, refresh_callback);
+    glfwSetKeyCallback(window, key_callback);
 
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -237,15 +260,24 @@ int main()
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    // corner attribute
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
-    // relative attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    // glEnableVertexAttribArray(1);
-    // texture coord attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+
+    // instance buffer: packed cell & pose of each sticker
+    unsigned int instanceVBO;
+    glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, stickerInstances.size() * sizeof(StickerInstance), NULL, GL_DYNAMIC_DRAW);
+
+    // cell attribute
+    glVertexAttribIPointer(3, 3, GL_BYTE, sizeof(StickerInstance), (void*)offsetof(StickerInstance, cell));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+    // pose attribute
+    glVertexAttribIPointer(4, 1, GL_UNSIGNED_BYTE, sizeof(StickerInstance), (void*)offsetof(StickerInstance, pose));
+    glEnableVertexAttribArray(4);
+    glVertexAttribDivisor(4, 1);
 
     // load and create a texture 
     // -------------------------
@@ -303,28 +335,34 @@ int main()
     ourShader.use();
     ourShader.setInt("texture1", 0);
     ourShader.setInt("texture2", 1);
-
-    // gen origin index
-    for (int j = 0; j < 3; ++j)
+    ourShader.setFloat("halfSideLen", halfSideLen);
+    ourShader.setInt("cubeOrder", CUBE_ORDER);
+    // resolve the per-frame uniforms once
+    Shader::Uniform projectionUniform = ourShader.getUniform("projection");
+    Shader::Uniform viewUniform = ourShader.getUniform("view");
+    Shader::Uniform editAxisUniform = ourShader.getUniform("editAxis");
+    Shader::Uniform editSliceUniform = ourShader.getUniform("editSlice");
+    Shader::Uniform turnAxisUniform = ourShader.getUniform("turnAxis");
+    Shader::Uniform sliceAngleUniform = ourShader.getUniform("sliceAngle");
+
+    // gen rotation matrix of the 24 orientations from their exact integer form
+    for (int rotation = 0; rotation < CubeRotation::COUNT; ++rotation)
     {
-        for (int k = 0; k < 3; ++k)
-        {
-            for (int i = 0; i < 3; ++i)
-            {
-                index[i][j][k] = i + k * 3 + j * 3 * 3;
-            }
-        }
+        rotationModel[rotation] = glm::mat4(1.0f);
+        for (int row = 0; row < 3; ++row)
+            for (int col = 0; col < 3; ++col)
+                rotationModel[rotation][col][row] = CubeRotation::get().matrix[rotation][row][col];
     }
-
-    // gen origin model matrix
-    for (int j = 0; j < 3; ++j)
-        for (int k = 0; k < 3; ++k)
-            for (int i = 0; i < 3; ++i)
-                cubeModel[index[i][j][k]] = glm::translate(glm::mat4(1.0f), ((glm::vec3*)cubeOriginPositions)[index[i][j][k]]);
-
-    nowEditing = NONE;
-    nowRotate = STOP;
-    double angle = 0;
+    // the vertex shader expands the orientation index through this table, kept in a uniform block
+    unsigned int rotationUBO;
+    glGenBuffers(1, &rotationUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, rotationUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(rotationModel), rotationModel, GL_STATIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, rotationUBO);
+    ourShader.bindUniformBlock("Rotations", 0);
+
+    nowEditing.axis = -1;
+    nowEditing.slice = 0;
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -337,7 +375,18 @@ int main()
 
         // input
         // -----
-        processInput(window);
+        processInput();
+        collectSolution();
+
+        // idle: nothing changed since the last frame, block until the next window event
+        if (!frameDirty && !animator.busy())
+        {
+            glfwWaitEvents();
+            // the time spent waiting must not count as a frame
+            lastFrame = glfwGetTime();
+            continue;
+        }
+        frameDirty = false;
 
         // render
         // ------
@@ -355,67 +404,51 @@ int main()
 
         // pass projection matrix to shader (note that in this case it could change every frame)
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)windowWidth / (float)windowHeight, 0.1f, 100.0f);
-        ourShader.setMat4("projection", projection);
+        ourShader.setMat4(projectionUniform, projection);
 
         // camera/view transformation
         glm::mat4 view = camera.GetViewMatrix();
-        ourShader.setMat4("view", view);
+        ourShader.setMat4(viewUniform, view);
 
         // render boxes
         glBindVertexArray(VAO);
 
-        glm::vec3 rotateVector = glm::vec3(0.0f);
-        // process rotation matrix
-        if (nowEditing && nowRotate)
+        // advance the turn animations, finished turns are applied to the cube state
+        animator.update(deltaTime, indexRedefine, batchRedefine);
+
+        // the instance buffer only changes when a turn completes
+        if (instancesDirty)
         {
-            if (abs(angle += ((float)nowRotate) * ANGULAR_SPEED * deltaTime) > 90.0f)
-            {
-                angle = 0;
-                indexRedefine();
-                nowRotate = STOP;
-            }
-            switch(nowEditing)
+            int instanceCount = 0;
+            for (int slot : stickerMesh.surfaceSlots)
             {
-            case Y_BOTTOM_SECTION:
-            case Y_MIDDLE_SECTION:
-            case Y_TOP_SECTION:
-                rotateVector = glm::vec3(0.0f, 1.0f, 0.0f);
-                break;
-            case Z_BACK_SECTION:
-            case Z_MIDDLE_SECTION:
-            case Z_FRONT_SECTION:
-                rotateVector = glm::vec3(0.0f, 0.0f, 1.0f);
-                break;
-            case X_LEFT_SECTION:
-            case X_MIDDLE_SECTION:
-            case X_RIGHT_SECTION:
-                rotateVector = glm::vec3(1.0f, 0.0f, 0.0f);
-                break;
-            }
-        }
-        for (int j = 0; j < 3; ++j)
-            for (int k = 0; k < 3; ++k)
-                for (int i = 0; i < 3; ++i)
+                int cubie = cubeState.cubie[slot];
+                for (int face = 0; face < 6; ++face)
                 {
-                    // calculate the model matrix for each object and pass it to shader before drawing
-                    glm::mat4 model = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-                    if (j + 1 == nowEditing || k + 1 == nowEditing >> 2 || i + 1 == nowEditing >> 4)
-                    {
-                        ourShader.setVec3("mask", glm::vec3(-0.5f, -0.5f, 1.0f));
-                        model = cubeModel[index[i][j][k]];
-                        if (nowRotate)
-                            model = glm::rotate(glm::mat4(1.0f), (float)glm::radians(angle), rotateVector) * cubeModel[index[i][j][k]];
-                    }
-                    else
-                    {
-                        ourShader.setVec3("mask", glm::vec3(0.0f, 0.0f, 0.0f));
-                        model = cubeModel[index[i][j][k]];
-                    }
-
-                    ourShader.setMat4("model", model);
-
-                    glDrawArrays(GL_TRIANGLES, 0, 36);
+                    if (!(stickerMesh.stickerFaces[cubie] >> face & 1))
+                        continue;
+                    StickerInstance& instance = stickerInstances[instanceCount++];
+                    int coord[3];
+                    cubeState.slotCoord(slot, coord);
+                    for (int axis = 0; axis < 3; ++axis)
+                        instance.cell[axis] = (int8_t)coord[axis];
+                    instance.pose = (uint8_t)(cubeState.orientation[slot] | face << 5);
                 }
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * sizeof(StickerInstance), stickerInstances.data());
+            instancesDirty = false;
+        }
+
+        // highlight & rotation of the editing section are applied by the vertex shader
+        ourShader.setInt(editAxisUniform, nowEditing.axis);
+        ourShader.setInt(editSliceUniform, nowEditing.slice);
+        float sliceAngle[CUBE_ORDER];
+        ourShader.setInt(turnAxisUniform, animator.sliceAngles(sliceAngle, CUBE_ORDER));
+        ourShader.setFloatArray(sliceAngleUniform, sliceAngle, CUBE_ORDER);
+
+        // draw every sticker of the magic cube in a single call
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)stickerInstances.size());
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -427,6 +460,11 @@ int main()
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &instanceVBO);
+    glDeleteBuffers(1, &rotationUBO);
+    // the solver thread wakes the render loop through glfw, let it finish first
+    if (solveTask.result.valid())
+        solveTask.result.wait();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -434,51 +472,145 @@ int main()
     return 0;
 }
 
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
-// ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow* window)
+// process all input: move the camera while movement keys are held and apply the queued commands
+// ---------------------------------------------------------------------------------------------
+void processInput()
 {
     float originSpeed = camera.MovementSpeed;
-    int operateFlag = 0;
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (fastMovement)
         camera.MovementSpeed = originSpeed * 4;
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        camera.ProcessKeyboard(RIGHT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS && nowEditing)
-        nowRotate = CONTC;
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS && nowEditing)
-        nowRotate = CLOCK;
-    if (glfwGetKey(window, GLFW_KEY_KP_1) == GLFW_PRESS && !nowRotate)
-        nowEditing = X_LEFT_SECTION;
-    if (glfwGetKey(window, GLFW_KEY_KP_2) == GLFW_PRESS && !nowRotate)
-        nowEditing = X_MIDDLE_SECTION;
-    if (glfwGetKey(window, GLFW_KEY_KP_3) == GLFW_PRESS && !nowRotate)
-        nowEditing = X_RIGHT_SECTION;
-
-    if (glfwGetKey(window, GLFW_KEY_KP_4) == GLFW_PRESS && !nowRotate)
-        nowEditing = Y_BOTTOM_SECTION;
-    if (glfwGetKey(window, GLFW_KEY_KP_5) == GLFW_PRESS && !nowRotate)
-        nowEditing = Y_MIDDLE_SECTION;
-    if (glfwGetKey(window, GLFW_KEY_KP_6) == GLFW_PRESS && !nowRotate)
-        nowEditing = Y_TOP_SECTION;
-
-    if (glfwGetKey(window, GLFW_KEY_KP_7) == GLFW_PRESS && !nowRotate)
-        nowEditing = Z_BACK_SECTION;
-    if (glfwGetKey(window, GLFW_KEY_KP_8) == GLFW_PRESS && !nowRotate)
-        nowEditing = Z_MIDDLE_SECTION;
-    if (glfwGetKey(window, GLFW_KEY_KP_9) == GLFW_PRESS && !nowRotate)
-        nowEditing = Z_FRONT_SECTION;
-    if (glfwGetKey(window, GLFW_KEY_KP_0) == GLFW_PRESS && !nowRotate)
-        nowEditing = NONE;
+    static const Camera_Movement movements[4] = { FORWARD, BACKWARD, LEFT, RIGHT };
+    for (int i = 0; i < 4; ++i)
+        if (movementHeld[i])
+        {
+            camera.ProcessKeyboard(movements[i], deltaTime);
+            // the camera keeps moving while a movement key is held
+            frameDirty = true;
+        }
     camera.MovementSpeed = originSpeed;
+
+    while (!inputQueue.empty())
+    {
+        const InputCommand& command = inputQueue.front();
+        switch (command.type)
+        {
+        case SELECT_SECTION:
+            nowEditing.axis = command.axis;
+            nowEditing.slice = command.slice;
+            break;
+        case STEP_SECTION:
+            if (nowEditing.axis >= 0)
+                nowEditing.slice = (nowEditing.slice + command.slice + CUBE_ORDER) % CUBE_ORDER;
+            break;
+        case TURN_SECTION:
+            if (nowEditing.axis >= 0)
+                animator.enqueue(CubeMove(nowEditing.axis, nowEditing.slice, command.dir));
+            break;
+        case TURN_WIDE:
+        case TURN_CUBE:
+            if (nowEditing.axis >= 0)
+            {
+                CubeMove moves[CUBE_ORDER];
+                int count = command.type == TURN_WIDE
+                    ? cubeWideMove(CUBE_ORDER, nowEditing.axis, nowEditing.slice, command.dir, moves)
+                    : cubeRotationMove(CUBE_ORDER, nowEditing.axis, command.dir, moves);
+                animator.enqueueTogether(moves, count);
+            }
+            break;
+        case SCRAMBLE_CUBE:
+        {
+            static std::mt19937 random((unsigned int)std::random_device()());
+            std::vector<CubeMove> scramble;
+            for (int i = 0; i < SCRAMBLE_LENGTH; ++i)
+                scramble.push_back(CubeMove(random() % 3, random() % CUBE_ORDER, random() % 2 ? CLOCK : CONTC));
+            // no point animating turns that cancel
+            simplifyCubeMoves(scramble, CUBE_ORDER);
+            animator.enqueue(scramble.data(), scramble.size());
+            break;
+        }
+        case TOGGLE_TURBO:
+            animator.turbo = !animator.turbo;
+            std::clog << "INFO::ANIMATION::TURBO <" << (animator.turbo ? "ON" : "OFF") << ">" << std::endl;
+            break;
+        case SOLVE_CUBE:
+            // the state to solve is only known once every queued turn is done
+            if (solveTask.result.valid() || animator.busy())
+                std::cerr << "WARNING::SOLVER::BUSY" << std::endl;
+            else
+                startSolve(cubeState);
+            break;
+        }
+#ifdef _DEBUG
+        std::clog << "INFO::INPUT::COMMAND_LATENCY <" << (glfwGetTime() - command.time) * 1000.0 << " ms>" << std::endl;
+#endif
+        inputQueue.pop();
+        frameDirty = true;
+    }
+}
+
+// glfw: whenever a key is pressed or released, this callback is called
+// --------------------------------------------------------------------
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    // keys that act while held down
+    static const int movementKeys[4] = { GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D };
+    for (int i = 0; i < 4; ++i)
+        if (key == movementKeys[i] && action != GLFW_REPEAT)
+        {
+            movementHeld[i] = action == GLFW_PRESS;
+            frameDirty = true;
+        }
+    if (key == GLFW_KEY_LEFT_SHIFT && action != GLFW_REPEAT)
+        fastMovement = action == GLFW_PRESS;
+
+    // keys that act once per press
+    if (action != GLFW_PRESS)
+        return;
+    if (key == GLFW_KEY_ESCAPE)
+    {
+        glfwSetWindowShouldClose(window, true);
+        return;
+    }
+
+    InputCommand command;
+    command.axis = -1;
+    command.slice = 0;
+    command.dir = STOP;
+    command.time = glfwGetTime();
+    // keypad 1-9 select the first / middle / last slice of the X, Y & Z axis, 0 clears the selection
+    if (key >= GLFW_KEY_KP_1 && key <= GLFW_KEY_KP_9)
+    {
+        const int sliceOfKey[3] = { 0, CUBE_ORDER / 2, CUBE_ORDER - 1 };
+        command.type = SELECT_SECTION;
+        command.axis = (key - GLFW_KEY_KP_1) / 3;
+        command.slice = sliceOfKey[(key - GLFW_KEY_KP_1) % 3];
+    }
+    else if (key == GLFW_KEY_KP_0)
+        command.type = SELECT_SECTION;
+    // keypad + / - step the selection through the inner slices of bigger cubes
+    else if (key == GLFW_KEY_KP_ADD || key == GLFW_KEY_KP_SUBTRACT)
+    {
+        command.type = STEP_SECTION;
+        command.slice = key == GLFW_KEY_KP_ADD ? 1 : -1;
+    }
+    // Q / E turn the editing section, with ctrl as a wide move, with alt the whole cube
+    else if (key == GLFW_KEY_Q || key == GLFW_KEY_E)
+    {
+        command.type = mods & GLFW_MOD_CONTROL ? TURN_WIDE : mods & GLFW_MOD_ALT ? TURN_CUBE : TURN_SECTION;
+        command.dir = key == GLFW_KEY_Q ? CONTC : CLOCK;
+    }
+    // R scrambles the cube, T toggles turbo playback
+    else if (key == GLFW_KEY_R)
+        command.type = SCRAMBLE_CUBE;
+    else if (key == GLFW_KEY_T)
+        command.type = TOGGLE_TURBO;
+    // enter solves the cube
+    else if (key == GLFW_KEY_ENTER)
+        command.type = SOLVE_CUBE;
+    else
+        return;
+    if (!inputQueue.push(command))
+        std::cerr << "WARNING::INPUT::COMMAND_QUEUE_FULL" << std::endl;
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -490,6 +622,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     glViewport(0, 0, width, height);
     windowWidth = width;
     windowHeight = height;
+    frameDirty = true;
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -510,6 +643,7 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
     lastY = ypos;
 
     camera.ProcessMouseMovement(xoffset, yoffset);
+    frameDirty = true;
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
@@ -517,113 +651,74 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
     camera.ProcessMouseScroll(yoffset);
+    frameDirty = true;
+}
+
+// glfw: whenever the window content needs to be redrawn (exposed, restored, ...), this callback is called
+// -------------------------------------------------------------------------------------------------------
+void refresh_callback(GLFWwindow* window)
+{
+    frameDirty = true;
+}
+
+// apply a finished turn to the cube state, a pure integer permutation
+// --------------------------------------------------------------------
+void indexRedefine(const CubeMove& move)
+{
+    cubeState.applyMove(move);
+    instancesDirty = true;
+}
+
+// apply the moves skipped by turbo playback at once, without the turns that cancel out
+// ------------------------------------------------------------------------------------
+void batchRedefine(const CubeMove* moves, size_t count)
+{
+    static std::vector<CubeMove> sequence;
+    sequence.assign(moves, moves + count);
+    simplifyCubeMoves(sequence, CUBE_ORDER);
+    cubeState.applyMoves(sequence.data(), sequence.size());
+    instancesDirty = true;
 }
 
-void indexRedefine()
+// solve the cube on a worker thread, the solvers only know the 3x3x3
+// -------------------------------------------------------------------
+template<int N>
+void startSolve(const Cube<N>& state)
 {
-    int originLayIndex[3][3],editingStage;
-    switch (nowEditing)
+    if constexpr (N == 3)
     {
-    case Y_BOTTOM_SECTION:
-    case Y_MIDDLE_SECTION:
-    case Y_TOP_SECTION:
-        editingStage = (nowEditing & 3) - 1;
-        for (int i = 0; i < 3; ++i)
-            for (int j = 0; j < 3; ++j)
-            {
-                originLayIndex[i][j] = index[i][editingStage][j];
-                cubeModel[index[i][editingStage][j]] = glm::rotate(glm::mat4(1.0f), nowRotate*(float)glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * cubeModel[index[i][editingStage][j]];
-            }
-        if (nowRotate == CLOCK)
-        {
-            index[0][editingStage][0] = originLayIndex[2][0];
-            index[0][editingStage][1] = originLayIndex[1][0];
-            index[0][editingStage][2] = originLayIndex[0][0];
-            index[1][editingStage][0] = originLayIndex[2][1];
-            index[1][editingStage][2] = originLayIndex[0][1];
-            index[2][editingStage][0] = originLayIndex[2][2];
-            index[2][editingStage][1] = originLayIndex[1][2];
-            index[2][editingStage][2] = originLayIndex[0][2];
-        }
-        else
-        {
-            index[0][editingStage][0] = originLayIndex[0][2];
-            index[0][editingStage][1] = originLayIndex[1][2];
-            index[0][editingStage][2] = originLayIndex[2][2];
-            index[1][editingStage][0] = originLayIndex[0][1];
-            index[1][editingStage][2] = originLayIndex[2][1];
-            index[2][editingStage][0] = originLayIndex[0][0];
-            index[2][editingStage][1] = originLayIndex[1][0];
-            index[2][editingStage][2] = originLayIndex[2][0];
-        }
-        break;
-    case Z_BACK_SECTION:
-    case Z_MIDDLE_SECTION:
-    case Z_FRONT_SECTION:
-        editingStage = ((nowEditing >> 2) & 3) - 1;
-        for (int i = 0; i < 3; ++i)
-            for (int j = 0; j < 3; ++j)
-            {
-                originLayIndex[i][j] = index[i][j][editingStage];
-                cubeModel[index[i][j][editingStage]] = glm::rotate(glm::mat4(1.0f), nowRotate * (float)glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * cubeModel[index[i][j][editingStage]];
-            }
-        if (nowRotate == CLOCK)
-        {
-            index[0][0][editingStage] = originLayIndex[0][2];
-            index[0][1][editingStage] = originLayIndex[1][2];
-            index[0][2][editingStage] = originLayIndex[2][2];
-            index[1][0][editingStage] = originLayIndex[0][1];
-            index[1][2][editingStage] = originLayIndex[2][1];
-            index[2][0][editingStage] = originLayIndex[0][0];
-            index[2][1][editingStage] = originLayIndex[1][0];
-            index[2][2][editingStage] = originLayIndex[2][0];
-        }
-        else
-        {
-            index[0][0][editingStage] = originLayIndex[2][0];
-            index[0][1][editingStage] = originLayIndex[1][0];
-            index[0][2][editingStage] = originLayIndex[0][0];
-            index[1][0][editingStage] = originLayIndex[2][1];
-            index[1][2][editingStage] = originLayIndex[0][1];
-            index[2][0][editingStage] = originLayIndex[2][2];
-            index[2][1][editingStage] = originLayIndex[1][2];
-            index[2][2][editingStage] = originLayIndex[0][2];
-        }  
-        break;
-    case X_LEFT_SECTION:
-    case X_MIDDLE_SECTION:
-    case X_RIGHT_SECTION:
-        editingStage = ((nowEditing >> 4) & 3) - 1;
-        for (int i = 0; i < 3; ++i)
-            for (int j = 0; j < 3; ++j)
-            {
-                originLayIndex[i][j] = index[editingStage][i][j];
-                cubeModel[index[editingStage][i][j]] = glm::rotate(glm::mat4(1.0f), nowRotate * (float)glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)) * cubeModel[index[editingStage][i][j]];
-            }
-        if (nowRotate == CLOCK)
+        CubieCube cube = CubieCube::fromCube(state, solveTask.frame);
+        solveTask.result = std::async(std::launch::async, [cube]()
         {
-            index[editingStage][0][0] = originLayIndex[0][2];
-            index[editingStage][0][1] = originLayIndex[1][2];
-            index[editingStage][0][2] = originLayIndex[2][2];
-            index[editingStage][1][0] = originLayIndex[0][1];
-            index[editingStage][1][2] = originLayIndex[2][1];
-            index[editingStage][2][0] = originLayIndex[0][0];
-            index[editingStage][2][1] = originLayIndex[1][0];
-            index[editingStage][2][2] = originLayIndex[2][0];
-        }
-        else
-        {
-            index[editingStage][0][0] = originLayIndex[2][0];
-            index[editingStage][0][1] = originLayIndex[1][0];
-            index[editingStage][0][2] = originLayIndex[0][0];
-            index[editingStage][1][0] = originLayIndex[2][1];
-            index[editingStage][1][2] = originLayIndex[0][1];
-            index[editingStage][2][0] = originLayIndex[2][2];
-            index[editingStage][2][1] = originLayIndex[1][2];
-            index[editingStage][2][2] = originLayIndex[0][2];
-        }
-        break;
-    default:
-        break;
+            TwoPhaseSolver::Result result = TwoPhaseSolver::get().solve(cube);
+            // wake the render loop in case it is idle
+            glfwPostEmptyEvent();
+            return result;
+        });
+    }
+    else
+        std::cerr << "WARNING::SOLVER::NEEDS_3X3X3 <" << N << "x" << N << "x" << N << ">" << std::endl;
+}
+
+// queue the solution once the solver thread is done, & report how the search went
+// --------------------------------------------------------------------------------
+void collectSolution()
+{
+    if (!solveTask.result.valid() || solveTask.result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+    TwoPhaseSolver::Result result = solveTask.result.get();
+    std::clog << "INFO::SOLVER::SOLUTION <";
+    for (size_t i = 0; i < result.moves.size(); ++i)
+        std::clog << (i ? " " : "") << faceMoveName(result.moves[i]);
+    std::clog << "> <" << result.moves.size() << " moves, " << result.seconds * 1000.0 << " ms, "
+              << result.phase1Nodes << " + " << result.phase2Nodes << " nodes>" << std::endl;
+    std::vector<CubeMove> sequence;
+    for (int move : result.moves)
+    {
+        CubeMove moves[2];
+        sequence.insert(sequence.end(), moves, moves + faceMoveToCubeMoves(move, solveTask.frame, moves));
     }
+    simplifyCubeMoves(sequence, CUBE_ORDER);
+    animator.enqueue(sequence.data(), sequence.size());
+    frameDirty = true;
 }
\ No newline at end of file
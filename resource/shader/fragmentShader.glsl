@@ -2,13 +2,13 @@
 out vec4 FragColor;
 
 in vec2 TexCoord;
+in vec3 Mask;
 
 // texture samplers
 uniform sampler2D texture1;
 uniform sampler2D texture2;
-uniform vec3 mask;
 void main()
 {
 	// linearly interpolate between both textures (80% container, 20% awesomeface)
-	FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.2) * vec4(vec3(1.0f,1.0f,1.0f)-mask, 1.0f);
+	FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.2) * vec4(vec3(1.0f,1.0f,1.0f)-Mask, 1.0f);
 }
\ No newline at end of file
@@ -1,16 +1,65 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aRel;
-layout (location = 2) in vec2 aTexCoord;
+layout (location = 0) in vec2 aCorner;
+// per-instance attributes
+layout (location = 3) in ivec3 aCell;
+layout (location = 4) in uint aPose;   // orientation index in the low 5 bits, face in the high 3 bits
 
 out vec2 TexCoord;
+out vec3 Mask;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform float halfSideLen;
+uniform int cubeOrder;
+// highlighted section, editAxis < 0 when nothing is selected
+uniform int editAxis;
+uniform int editSlice;
+// turning slices, turnAxis < 0 when nothing is turning, otherwise each slice of that axis
+// turns by its own angle (up to the largest supported cube order)
+uniform int turnAxis;
+uniform float sliceAngle[32];
+
+// the 24 rotations of a cube, indexed by orientation
+layout (std140) uniform Rotations
+{
+	mat4 rotation[24];
+};
+
+// outward normal & texture axes of each cubie face: back, front, left, right, bottom, top
+const vec3 faceNormal[6] = vec3[6](vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, 1.0f), vec3(-1.0f, 0.0f, 0.0f),
+                                   vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, -1.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+const vec3 faceU[6] = vec3[6](vec3(1.0f, 0.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f),
+                              vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f));
+const vec3 faceV[6] = vec3[6](vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 0.0f, -1.0f),
+                              vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f));
+
+// rotation around the x, y or z axis, same convention as glm::rotate
+mat4 axisRotation(int axis, float angle)
+{
+	float c = cos(angle), s = sin(angle);
+	if (axis == 0)
+		return mat4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	if (axis == 1)
+		return mat4(c, 0.0f, -s, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, s, 0.0f, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	return mat4(c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
 
 void main()
 {
+	ivec3 cell = aCell;
+	int face = int(aPose >> 5u);
+	int orientation = int(aPose & 31u);
+
+	// expand the unit quad onto the sticker's face of the cubie
+	vec2 corner = aCorner * 2.0f - 1.0f;
+	vec3 aPos = (faceNormal[face] + corner.x * faceU[face] + corner.y * faceV[face]) * halfSideLen;
+	// the cubie sits in its grid cell, turned by its orientation
+	vec3 center = (vec3(cell) - float(cubeOrder - 1) * 0.5f) * (2.0f * halfSideLen);
+	mat4 model = rotation[orientation];
+	model[3] = vec4(center, 1.0f);
+	if (turnAxis >= 0 && sliceAngle[cell[turnAxis]] != 0.0f)
+		model = axisRotation(turnAxis, sliceAngle[cell[turnAxis]]) * model;
 	gl_Position = projection * view * model * vec4(aPos, 1.0f);
-	TexCoord = vec2(aTexCoord.x, aTexCoord.y);
+	TexCoord = aCorner;
+	Mask = (editAxis >= 0 && cell[editAxis] == editSlice) ? vec3(-0.5f, -0.5f, 1.0f) : vec3(0.0f, 0.0f, 0.0f);
 }
\ No newline at end of file
@@ -0,0 +1,183 @@
+#ifndef BATCH_SOLVER_H
+#define BATCH_SOLVER_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cubieCube.h"
+#include "moveSequence.h"
+#include "optimalSolver.h"
+#include "twoPhaseSolver.h"
+
+// Headless batch mode: one scramble per input line (face moves, see parseFaceMoves()), one line per scramble on
+// the output in input order, "<solution>\t<length>\t<milliseconds>". Lines that do not parse give "ERROR", empty
+// lines stay empty so the output lines up with the input.
+// Every thread solves whole scrambles (the optimal solver single threaded), a bounded window of lines is in flight
+// so arbitrarily long inputs stream through in constant memory. Throughput is reported on std::clog, for the optimal
+// solver also the statistics of the transposition table its threads share.
+// Returns the number of lines that could not be solved.
+inline int runBatchSolver(std::istream& in, std::ostream& out, int threads = 0, bool optimal = false)
+{
+    typedef std::chrono::steady_clock Clock;
+    if (threads <= 0)
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    Clock::time_point start = Clock::now();
+    const TwoPhaseSolver* twoPhase = optimal ? nullptr : &TwoPhaseSolver::get();
+    const OptimalSolver* best = optimal ? &OptimalSolver::get() : nullptr;
+    std::clog << "INFO::BATCH::TABLES <" << std::chrono::duration<double>(Clock::now() - start).count() << " s>" << std::endl;
+
+    const size_t window = (size_t)threads * 64;
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<std::pair<size_t, std::string>> jobs;
+    // result of line i at i % window
+    std::vector<std::string> results(window);
+    std::vector<char> ready(window, 0);
+    size_t read = 0, written = 0, solved = 0, moveCount = 0;
+    int failures = 0;
+    bool finished = false;
+
+    auto solve = [&](const std::string& line, int& length) -> std::string
+    {
+        std::vector<int> moves;
+        if (!parseFaceMoves(line, moves))
+            return "ERROR";
+        if (moves.empty())
+            return "";
+        const CubieCube cube = composeFaceMoves(moves);
+        Clock::time_point begin = Clock::now();
+        std::vector<int> solution;
+        bool found;
+        if (optimal)
+        {
+            OptimalSolver::Result result = best->solve(cube, 1);
+            found = result.found;
+            solution = result.moves;
+        }
+        else
+        {
+            TwoPhaseSolver::Result result = twoPhase->solve(cube);
+            found = result.found;
+            solution = result.moves;
+        }
+        const double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        if (!found)
+            return "ERROR";
+        simplifyFaceMoves(solution);
+        std::ostringstream text;
+        for (size_t i = 0; i < solution.size(); ++i)
+            text << (i ? " " : "") << faceMoveName(solution[i]);
+        text << '\t' << solution.size() << '\t' << milliseconds;
+        length = (int)solution.size();
+        return text.str();
+    };
+    auto work = [&]()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        for (;;)
+        {
+            changed.wait(guard, [&]()
+            {
+                return !jobs.empty() || finished;
+            });
+            if (jobs.empty())
+                return;
+            std::pair<size_t, std::string> job = std::move(jobs.front());
+            jobs.pop_front();
+            guard.unlock();
+            int length = -1;
+            std::string result = solve(job.second, length);
+            guard.lock();
+            results[job.first % window] = std::move(result);
+            ready[job.first % window] = 1;
+            if (length >= 0)
+            {
+                ++solved;
+                moveCount += length;
+            }
+            else
+                failures += results[job.first % window] == "ERROR";
+            changed.notify_all();
+        }
+    };
+    auto readLines = [&]()
+    {
+        std::string line;
+        while (std::getline(in, line))
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            changed.wait(guard, [&]()
+            {
+                return read - written < window;
+            });
+            jobs.emplace_back(read++, std::move(line));
+            changed.notify_all();
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        finished = true;
+        changed.notify_all();
+    };
+
+    start = Clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i)
+        workers.emplace_back(work);
+    std::thread reader(readLines);
+    // this thread writes the results in order, flushing whenever it has to wait for the next one
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        for (;;)
+        {
+            if (!ready[written % window])
+            {
+                if (finished && written == read)
+                    break;
+                guard.unlock();
+                out.flush();
+                guard.lock();
+                changed.wait(guard, [&]()
+                {
+                    return ready[written % window] || (finished && written == read);
+                });
+                continue;
+            }
+            std::string result = std::move(results[written % window]);
+            ready[written % window] = 0;
+            ++written;
+            changed.notify_all();
+            guard.unlock();
+            out << result << '\n';
+            guard.lock();
+        }
+    }
+    reader.join();
+    for (std::thread& worker : workers)
+        worker.join();
+    out.flush();
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::clog << "INFO::BATCH::DONE <" << solved << " solved, " << failures << " failed, " << seconds << " s, "
+              << solved / std::max(seconds, 1e-9) << " solves/s, " << (solved ? (double)moveCount / solved : 0.0)
+              << " moves average, " << threads << " threads>" << std::endl;
+    if (optimal)
+    {
+        // every thread solved through the same table
+        const TranspositionTable& table = best->transpositionTable();
+        const TranspositionTable::Statistics stats = table.statistics();
+        std::clog << "INFO::BATCH::TRANSPOSITIONS <" << stats.probes << " probes, hit rate " << stats.hitRate() * 100.0 << "%, "
+                  << stats.stores << " stores, " << stats.replacements << " replacements, " << stats.dropped << " dropped, "
+                  << table.fill() * 100.0 << "% full>" << std::endl;
+    }
+    return failures;
+}
+#endif
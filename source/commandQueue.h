@@ -0,0 +1,55 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free single-producer / single-consumer ring buffer.
+// The producer (e.g. a GLFW input callback) only calls push(), the consumer (the simulation) only
+// calls front(), pop() & empty(), so neither side ever blocks or allocates.
+template<class T, size_t Capacity>
+class CommandQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+public:
+    CommandQueue() : head(0), tail(0) {}
+
+    // returns false (and drops the command) when the queue is full
+    bool push(const T& command)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        buffer[t & (Capacity - 1)] = command;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+    }
+
+    size_t size() const
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_relaxed);
+    }
+
+    // oldest command, only valid when the queue is not empty
+    const T& front() const
+    {
+        return buffer[head.load(std::memory_order_relaxed) & (Capacity - 1)];
+    }
+
+    void pop()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    T buffer[Capacity];
+    // head is only written by the consumer, tail only by the producer, keep them on separate cache lines
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+#endif
@@ -0,0 +1,281 @@
+#ifndef CUBE_BATCH_H
+#define CUBE_BATCH_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cubieCube.h"
+#include "packedCube.h"
+
+// Many 3x3x3 cubie states in structure-of-arrays layout, for turning all of them the same way at once.
+//
+// Each of the 20 cubie positions has a plane of one byte per lane, in the encoding of PackedCube (cubie | twist * 16).
+// Since every lane gets the same move, its permutation is the same relabelling of the planes for all lanes:
+// position i of cube * move reads plane[move.cp[i]], so only plane[] changes. Only positions whose orientation
+// changes need a pass over their lanes (x += twist * 16, then x = min(x, x - modulus) as in PackedCube), 4 planes for
+// R, L & 8 for F, B, none for U, D. Such a pass is a plain byte loop over contiguous lanes, run with AVX2 or SSE2.
+// A sequence is composed into one CubieCube first, so it costs the same as a single move however long it is.
+// Large batches split every pass over a pool of threads in ranges of whole cache lines. The pool is started with the
+// batch & lives as long as it, so a move costs a wake-up of the threads, not their creation.
+class CubeBatch
+{
+public:
+    // lanes one thread takes at least before multiply() splits a pass between threads
+    static const size_t LANES_PER_THREAD = 1 << 16;
+
+    // threads multiply() may run on, 0 uses every core
+    explicit CubeBatch(size_t lanes = 0, int threads = 1) : round(0), parts(0), pending(0), stopping(false)
+    {
+        resize(lanes);
+        if (threads <= 0)
+            threads = std::max(1, (int)std::thread::hardware_concurrency());
+        for (int t = 1; t < threads; ++t)
+            workers.emplace_back([this, t]()
+            {
+                work(t);
+            });
+    }
+    ~CubeBatch()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+    // the pool works on this batch
+    CubeBatch(const CubeBatch&) = delete;
+    CubeBatch& operator=(const CubeBatch&) = delete;
+
+    int threads() const
+    {
+        return (int)workers.size() + 1;
+    }
+
+    // every lane solved
+    void resize(size_t lanes)
+    {
+        count = lanes;
+        // planes start on a cache line
+        stride = (lanes + 63) / 64 * 64;
+        data.assign(stride * 20, 0);
+        for (int i = 0; i < 20; ++i)
+        {
+            plane[i] = (uint8_t)i;
+            std::fill(data.begin() + stride * i, data.begin() + stride * i + lanes, (uint8_t)(i < 8 ? i : i - 8));
+        }
+    }
+    size_t size() const
+    {
+        return count;
+    }
+
+    void set(size_t lane, const CubieCube& cube)
+    {
+        const PackedCube packed(cube);
+        for (int i = 0; i < 8; ++i)
+            data[stride * plane[i] + lane] = packed.bytes[i];
+        for (int i = 0; i < 12; ++i)
+            data[stride * plane[8 + i] + lane] = packed.bytes[16 + i];
+    }
+    CubieCube get(size_t lane) const
+    {
+        PackedCube packed;
+        for (int i = 0; i < 8; ++i)
+            packed.bytes[i] = data[stride * plane[i] + lane];
+        for (int i = 0; i < 12; ++i)
+            packed.bytes[16 + i] = data[stride * plane[8 + i] + lane];
+        return packed.toCubie();
+    }
+
+    // every lane = lane * other
+    void multiply(const CubieCube& other)
+    {
+        uint8_t next[20];
+        int twisted[20];
+        uint8_t add[20], modulus[20];
+        int changed = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            next[i] = plane[other.cp[i]];
+            if (other.co[i])
+            {
+                twisted[changed] = next[i];
+                add[changed] = (uint8_t)(other.co[i] << 4);
+                modulus[changed++] = 0x30;
+            }
+        }
+        for (int i = 0; i < 12; ++i)
+        {
+            next[8 + i] = plane[8 + other.ep[i]];
+            if (other.eo[i])
+            {
+                twisted[changed] = next[8 + i];
+                add[changed] = 0x10;
+                modulus[changed++] = 0x20;
+            }
+        }
+        std::copy(next, next + 20, plane);
+        if (changed == 0)
+            return;
+        parallelFor([&](size_t begin, size_t end)
+        {
+            for (int k = 0; k < changed; ++k)
+                orient(data.data() + stride * twisted[k] + begin, end - begin, add[k], modulus[k]);
+        });
+    }
+    void applyMove(int m)
+    {
+        multiply(CubieCube::move(m));
+    }
+    void applyMoves(const int* moves, size_t length)
+    {
+        CubieCube sequence;
+        for (size_t i = 0; i < length; ++i)
+            sequence.applyMove(moves[i]);
+        multiply(sequence);
+    }
+
+    // lanes holding the solved cube
+    size_t solvedCount() const
+    {
+        size_t solved = 0;
+        for (size_t lane = 0; lane < count; ++lane)
+        {
+            bool same = true;
+            for (int i = 0; i < 20 && same; ++i)
+                same = data[stride * plane[i] + lane] == (i < 8 ? i : i - 8);
+            solved += same;
+        }
+        return solved;
+    }
+
+private:
+    size_t count;
+    size_t stride;
+    // physical plane of each position, corners 0 - 7 & edges 8 - 19
+    uint8_t plane[20];
+    std::vector<uint8_t> data;
+
+    // the pool: a round runs job on parts ranges, range p on thread p, pending counts the workers not done yet
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void(int)> job;
+    uint64_t round;
+    int parts;
+    int pending;
+    bool stopping;
+
+    // pass(begin, end) over the lanes, split into cache-line-aligned ranges of at least LANES_PER_THREAD lanes
+    template<class Pass>
+    void parallelFor(const Pass& pass)
+    {
+        const int used = (int)std::min<size_t>(threads(), std::max<size_t>(1, count / LANES_PER_THREAD));
+        if (used == 1)
+        {
+            pass(0, count);
+            return;
+        }
+        const size_t chunk = (count / used + 63) / 64 * 64;
+        auto range = [&pass, chunk, this](int p)
+        {
+            const size_t begin = std::min(count, p * chunk), end = std::min(count, begin + chunk);
+            if (begin < end)
+                pass(begin, end);
+        };
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = range;
+            parts = used;
+            pending = used - 1;
+            ++round;
+        }
+        wake.notify_all();
+        range(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]()
+        {
+            return pending == 0;
+        });
+        job = nullptr;
+    }
+    void work(int index)
+    {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            wake.wait(lock, [&]()
+            {
+                return stopping || round != seen;
+            });
+            if (stopping)
+                return;
+            seen = round;
+            // small passes leave the last threads out
+            if (index >= parts)
+                continue;
+            lock.unlock();
+            job(index);
+            lock.lock();
+            if (--pending == 0)
+                done.notify_one();
+        }
+    }
+
+    static void orient(uint8_t* lanes, size_t length, uint8_t add, uint8_t modulus)
+    {
+        size_t done = 0;
+#ifdef PACKED_CUBE_X86
+        if (PackedCube::kernel() == PackedCube::KERNEL_AVX2)
+            done = orientAvx2(lanes, length, add, modulus);
+        else
+            done = orientSse2(lanes, length, add, modulus);
+#endif
+        for (size_t l = done; l < length; ++l)
+        {
+            const int x = lanes[l] + add;
+            lanes[l] = (uint8_t)(x >= modulus ? x - modulus : x);
+        }
+    }
+
+#ifdef PACKED_CUBE_X86
+    // both return the number of lanes done, the rest is left to the byte loop
+    PACKED_CUBE_TARGET("avx2")
+    static size_t orientAvx2(uint8_t* lanes, size_t length, uint8_t add, uint8_t modulus)
+    {
+        const __m256i addVector = _mm256_set1_epi8((char)add), modulusVector = _mm256_set1_epi8((char)modulus);
+        size_t l = 0;
+        for (; l + 32 <= length; l += 32)
+        {
+            __m256i x = _mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(lanes + l)), addVector);
+            x = _mm256_min_epu8(x, _mm256_sub_epi8(x, modulusVector));
+            _mm256_storeu_si256((__m256i*)(lanes + l), x);
+        }
+        return l;
+    }
+    static size_t orientSse2(uint8_t* lanes, size_t length, uint8_t add, uint8_t modulus)
+    {
+        const __m128i addVector = _mm_set1_epi8((char)add), modulusVector = _mm_set1_epi8((char)modulus);
+        size_t l = 0;
+        for (; l + 16 <= length; l += 16)
+        {
+            __m128i x = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(lanes + l)), addVector);
+            x = _mm_min_epu8(x, _mm_sub_epi8(x, modulusVector));
+            _mm_storeu_si128((__m128i*)(lanes + l), x);
+        }
+        return l;
+    }
+#endif
+};
+#endif
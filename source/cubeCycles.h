@@ -0,0 +1,340 @@
+#ifndef CUBE_CYCLES_H
+#define CUBE_CYCLES_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cubeState.h"
+#include "cubieCube.h"
+
+// Cycle structure, order & powers of a cube state, each in one pass over its pieces.
+//
+// A state composed from a move sequence (see composeMoves()) is a permutation: position s takes the piece of
+// position source[s] & adds its own orientation r[s] to it. Following source from s runs through a cycle
+// c0 = s, c1 = source[c0], ... of length L, and the k-th power puts the piece of c(k mod L) at s with the
+// orientations r[c0], r[c1], ... r[c(k - 1)] combined on the way. That run repeats every L steps, so it is
+// (once around)^(k / L) followed by the first k mod L orientations, & with prefix products over the cycle run twice
+// every such stretch is inverse(prefix[j]) * prefix[j + length] for any start j. The twist once around has order 1 - 4,
+// so a cycle returns to solved after L * that order moves & the state after the least common multiple over all
+// cycles. A piece only visits the 24 or fewer positions of its orbit, so every cycle is done after at most 96 moves,
+// but large cubes have many orbits & the least common multiple of numbers up to 96 is about 10^41, hence BigUnsigned.
+// The order of a 3x3x3 sequence is at most 1260.
+//
+// The NxNxN model tells every cubie apart, centres & hidden inner cubies included, and counts their rotation as
+// well: its order is the one of the model, a sticker-only cube may look solved sooner.
+
+// natural number of any size, just what the order of a state needs
+class BigUnsigned
+{
+public:
+    BigUnsigned(uint64_t value = 0)
+    {
+        while (value)
+        {
+            limbs.push_back((uint32_t)value);
+            value >>= 32;
+        }
+    }
+
+    void multiply(uint32_t factor)
+    {
+        uint64_t carry = 0;
+        for (uint32_t& limb : limbs)
+        {
+            carry += (uint64_t)limb * factor;
+            limb = (uint32_t)carry;
+            carry >>= 32;
+        }
+        if (carry)
+            limbs.push_back((uint32_t)carry);
+        if (factor == 0)
+            limbs.clear();
+    }
+    uint32_t remainder(uint32_t divisor) const
+    {
+        uint64_t rest = 0;
+        for (size_t i = limbs.size(); i-- > 0;)
+            rest = (rest << 32 | limbs[i]) % divisor;
+        return (uint32_t)rest;
+    }
+    // this = lcm(this, value), value > 0
+    void lcm(uint32_t value)
+    {
+        uint32_t a = remainder(value), b = value;
+        while (a)
+        {
+            uint32_t t = b % a;
+            b = a;
+            a = t;
+        }
+        multiply(value / b);
+    }
+
+    bool fitsUint64() const
+    {
+        return limbs.size() <= 2;
+    }
+    // lowest 64 bits
+    uint64_t toUint64() const
+    {
+        return (limbs.size() > 0 ? limbs[0] : 0) | (limbs.size() > 1 ? (uint64_t)limbs[1] << 32 : 0);
+    }
+    std::string toString() const
+    {
+        // base 10^9 digits, lowest first
+        std::vector<uint32_t> rest = limbs, digits;
+        while (!rest.empty())
+        {
+            uint64_t carry = 0;
+            for (size_t i = rest.size(); i-- > 0;)
+            {
+                carry = carry << 32 | rest[i];
+                rest[i] = (uint32_t)(carry / 1000000000);
+                carry %= 1000000000;
+            }
+            digits.push_back((uint32_t)carry);
+            while (!rest.empty() && rest.back() == 0)
+                rest.pop_back();
+        }
+        if (digits.empty())
+            return "0";
+        std::string text = std::to_string(digits.back());
+        for (size_t i = digits.size() - 1; i-- > 0;)
+        {
+            std::string part = std::to_string(digits[i]);
+            text += std::string(9 - part.size(), '0') + part;
+        }
+        return text;
+    }
+
+    bool operator==(const BigUnsigned& other) const
+    {
+        return limbs == other.limbs;
+    }
+    bool operator!=(const BigUnsigned& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    // base 2^32, lowest first, no leading zeros
+    std::vector<uint32_t> limbs;
+};
+
+// orientations of the 3x3x3 cubies: twists modulo 3 (corners) or flips modulo 2 (edges), 0 is none
+struct TwistGroup
+{
+    int modulus;
+
+    uint8_t combine(int a, int b) const
+    {
+        return (uint8_t)((a + b) % modulus);
+    }
+    uint8_t inverse(int a) const
+    {
+        return (uint8_t)((modulus - a) % modulus);
+    }
+    int order(int a) const
+    {
+        return a == 0 ? 1 : modulus;
+    }
+};
+
+// orientations of the NxNxN cubies: the 24 rotations, CubeRotation::IDENTITY (0) is none
+struct RotationGroup
+{
+    uint8_t combine(int a, int b) const
+    {
+        return CubeRotation::get().compose[a][b];
+    }
+    uint8_t inverse(int a) const
+    {
+        return CubeRotation::get().inverse[a];
+    }
+    int order(int a) const
+    {
+        static const struct Orders
+        {
+            int value[CubeRotation::COUNT];
+            Orders()
+            {
+                const CubeRotation& rotations = CubeRotation::get();
+                for (int r = 0; r < CubeRotation::COUNT; ++r)
+                {
+                    value[r] = 1;
+                    for (int power = r; power != CubeRotation::IDENTITY; power = rotations.compose[r][power])
+                        ++value[r];
+                }
+            }
+        } orders;
+        return orders.value[a];
+    }
+};
+
+// one cycle of positions: start, start's source, ... with the orientation a piece picks up once around it
+struct PieceCycle
+{
+    int start;
+    int length;
+    uint8_t twist;
+    // moves until every piece of the cycle is back in place & unturned, length * order of twist
+    uint32_t order;
+};
+
+// every cycle of a permutation (fixed positions included, as cycles of length 1)
+template<class CubieId, class Group>
+void permutationCycles(int count, const CubieId* source, const uint8_t* orientation, const Group& group, std::vector<PieceCycle>& cycles)
+{
+    cycles.clear();
+    std::vector<char> seen(count, 0);
+    for (int start = 0; start < count; ++start)
+    {
+        if (seen[start])
+            continue;
+        PieceCycle cycle = { start, 0, 0, 0 };
+        for (int s = start; !seen[s]; s = source[s])
+        {
+            seen[s] = 1;
+            cycle.twist = group.combine(cycle.twist, orientation[s]);
+            ++cycle.length;
+        }
+        cycle.order = (uint32_t)cycle.length * group.order(cycle.twist);
+        cycles.push_back(cycle);
+    }
+}
+
+// the k-th power of a permutation, reduce(period) must give k modulo period
+template<class CubieId, class Group, class Reduce>
+void permutationPower(int count, const CubieId* source, const uint8_t* orientation, const Group& group, Reduce reduce,
+                      CubieId* powerSource, uint8_t* powerOrientation)
+{
+    std::vector<char> seen(count, 0);
+    std::vector<int> cycle;
+    std::vector<uint8_t> prefix;
+    for (int start = 0; start < count; ++start)
+    {
+        if (seen[start])
+            continue;
+        cycle.clear();
+        for (int s = start; !seen[s]; s = source[s])
+        {
+            seen[s] = 1;
+            cycle.push_back(s);
+        }
+        const int length = (int)cycle.size();
+        // prefix[i] combines the orientations of the first i positions of the cycle run twice
+        prefix.assign(2 * length + 1, 0);
+        for (int i = 0; i < 2 * length; ++i)
+            prefix[i + 1] = group.combine(prefix[i], orientation[cycle[i % length]]);
+        const uint32_t k = reduce((uint32_t)length * group.order(prefix[length]));
+        const int rounds = (int)(k / length), rest = (int)(k % length);
+        for (int j = 0; j < length; ++j)
+        {
+            const uint8_t before = group.inverse(prefix[j]);
+            const uint8_t around = group.combine(before, prefix[j + length]);
+            uint8_t value = 0;
+            for (int r = 0; r < rounds; ++r)
+                value = group.combine(value, around);
+            powerSource[cycle[j]] = (CubieId)cycle[(j + rest) % length];
+            powerOrientation[cycle[j]] = group.combine(value, group.combine(before, prefix[j + rest]));
+        }
+    }
+}
+
+// lengths of the cycles that move or turn anything, largest first, "x<order>" marking those that also turn their
+// pieces, e.g. "5 3x3 2" ("identity" if there are none)
+inline std::string formatCycles(std::vector<PieceCycle> cycles)
+{
+    std::sort(cycles.begin(), cycles.end(), [](const PieceCycle& a, const PieceCycle& b)
+    {
+        return a.length != b.length ? a.length > b.length : a.order > b.order;
+    });
+    std::ostringstream text;
+    bool first = true;
+    for (const PieceCycle& cycle : cycles)
+    {
+        if (cycle.order == 1)
+            continue;
+        text << (first ? "" : " ") << cycle.length;
+        if (cycle.order > (uint32_t)cycle.length)
+            text << 'x' << cycle.order / cycle.length;
+        first = false;
+    }
+    return first ? "identity" : text.str();
+}
+
+// 3x3x3 cubie states
+// ------------------
+// cube must be a proper cube (corner twists 0 - 2), not a reflection, see cubeSymmetry.h
+inline void cubieCycles(const CubieCube& cube, std::vector<PieceCycle>& corners, std::vector<PieceCycle>& edges)
+{
+    permutationCycles(8, cube.cp, cube.co, TwistGroup{ 3 }, corners);
+    permutationCycles(12, cube.ep, cube.eo, TwistGroup{ 2 }, edges);
+}
+inline std::string cubieCycleStructure(const CubieCube& cube)
+{
+    std::vector<PieceCycle> corners, edges;
+    cubieCycles(cube, corners, edges);
+    return "corners " + formatCycles(corners) + ", edges " + formatCycles(edges);
+}
+inline uint64_t cubieOrder(const CubieCube& cube)
+{
+    std::vector<PieceCycle> corners, edges;
+    cubieCycles(cube, corners, edges);
+    BigUnsigned order(1);
+    for (const PieceCycle& cycle : corners)
+        order.lcm(cycle.order);
+    for (const PieceCycle& cycle : edges)
+        order.lcm(cycle.order);
+    return order.toUint64();
+}
+inline CubieCube cubiePower(const CubieCube& cube, uint64_t k)
+{
+    CubieCube power;
+    auto reduce = [k](uint32_t period)
+    {
+        return (uint32_t)(k % period);
+    };
+    permutationPower(8, cube.cp, cube.co, TwistGroup{ 3 }, reduce, power.cp, power.co);
+    permutationPower(12, cube.ep, cube.eo, TwistGroup{ 2 }, reduce, power.ep, power.eo);
+    return power;
+}
+
+// NxNxN states, Cube<N> or DynamicCube
+// ------------------------------------
+template<class CubeType>
+void cubeCycles(const CubeType& cube, std::vector<PieceCycle>& cycles)
+{
+    permutationCycles(cube.slotCount(), cube.cubie.data(), cube.orientation.data(), RotationGroup(), cycles);
+}
+template<class CubeType>
+std::string cubeCycleStructure(const CubeType& cube)
+{
+    std::vector<PieceCycle> cycles;
+    cubeCycles(cube, cycles);
+    return formatCycles(cycles);
+}
+template<class CubeType>
+BigUnsigned cubeOrder(const CubeType& cube)
+{
+    std::vector<PieceCycle> cycles;
+    cubeCycles(cube, cycles);
+    BigUnsigned order(1);
+    for (const PieceCycle& cycle : cycles)
+        order.lcm(cycle.order);
+    return order;
+}
+// cube applied k times, for any k
+template<class CubeType>
+CubeType cubePower(const CubeType& cube, const BigUnsigned& k)
+{
+    CubeType power = cube;
+    permutationPower(cube.slotCount(), cube.cubie.data(), cube.orientation.data(), RotationGroup(),
+                     [&k](uint32_t period) { return k.remainder(period); }, power.cubie.data(), power.orientation.data());
+    return power;
+}
+#endif
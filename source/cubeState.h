@@ -0,0 +1,493 @@
+#ifndef CUBE_STATE_H
+#define CUBE_STATE_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Headless model of the NxNxN magic cube, independent of OpenGL so it can be used by tests & tools.
+//
+// The cube is a NxNxN grid of slots, slot = x + z * N + y * N * N with x, y, z in [0, N - 1].
+// Each slot holds one cubie (identified by the slot it occupies when solved) and the
+// orientation of that cubie, stored as an index into the 24 proper rotations of a cube.
+
+// axis of a slice
+enum CubeAxis
+{
+    AXIS_X = 0,
+    AXIS_Y = 1,
+    AXIS_Z = 2
+};
+
+// a quarter turn of one slice, dir = 1 turns by +90 degree around the positive axis (right-hand rule), -1 by -90 degree
+struct CubeMove
+{
+    int8_t axis;
+    int8_t slice;
+    int8_t dir;
+
+    CubeMove(int axis = AXIS_X, int slice = 0, int dir = 1) : axis((int8_t)axis), slice((int8_t)slice), dir((int8_t)dir) {}
+
+    // dense index in [0, 3 * order * 2)
+    int id(int order = 3) const
+    {
+        return (axis * order + slice) * 2 + (dir < 0);
+    }
+    CubeMove inverse() const
+    {
+        return CubeMove(axis, slice, -dir);
+    }
+    bool operator==(const CubeMove& other) const
+    {
+        return axis == other.axis && slice == other.slice && dir == other.dir;
+    }
+    bool operator!=(const CubeMove& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// the 24 rotations of a cube as integer matrices, with composition & inverse lookup tables
+class CubeRotation
+{
+public:
+    static const int COUNT = 24;
+    static const int IDENTITY = 0;
+
+    // row-major integer rotation matrix, entries are -1, 0 or 1
+    int8_t matrix[COUNT][3][3];
+    // compose[a][b] is the rotation "b first, then a" (matrix product a * b)
+    uint8_t compose[COUNT][COUNT];
+    uint8_t inverse[COUNT];
+    // quarterTurn[axis][dir < 0] is the +90 / -90 degree rotation around axis
+    uint8_t quarterTurn[3][2];
+
+    static const CubeRotation& get()
+    {
+        static const CubeRotation table;
+        return table;
+    }
+
+    // rotate a vector, components may be any integer
+    void apply(int rotation, const int in[3], int out[3]) const
+    {
+        for (int r = 0; r < 3; ++r)
+            out[r] = matrix[rotation][r][0] * in[0] + matrix[rotation][r][1] * in[1] + matrix[rotation][r][2] * in[2];
+    }
+
+private:
+    CubeRotation()
+    {
+        // enumerate signed permutation matrices with determinant +1, identity comes first
+        static const int perms[6][3] = { {0, 1, 2}, {1, 2, 0}, {2, 0, 1}, {0, 2, 1}, {2, 1, 0}, {1, 0, 2} };
+        int count = 0;
+        for (int p = 0; p < 6; ++p)
+            for (int signs = 0; signs < 8; ++signs)
+            {
+                int det = p < 3 ? 1 : -1;
+                for (int r = 0; r < 3; ++r)
+                    if (signs >> r & 1)
+                        det = -det;
+                if (det != 1)
+                    continue;
+                std::memset(matrix[count], 0, sizeof(matrix[count]));
+                for (int r = 0; r < 3; ++r)
+                    matrix[count][r][perms[p][r]] = (signs >> r & 1) ? -1 : 1;
+                ++count;
+            }
+        for (int a = 0; a < COUNT; ++a)
+            for (int b = 0; b < COUNT; ++b)
+            {
+                int8_t product[3][3];
+                for (int r = 0; r < 3; ++r)
+                    for (int c = 0; c < 3; ++c)
+                        product[r][c] = (int8_t)(matrix[a][r][0] * matrix[b][0][c] + matrix[a][r][1] * matrix[b][1][c] + matrix[a][r][2] * matrix[b][2][c]);
+                compose[a][b] = (uint8_t)find(product);
+                if (compose[a][b] == IDENTITY)
+                    inverse[a] = (uint8_t)b;
+            }
+        for (int axis = 0; axis < 3; ++axis)
+            for (int neg = 0; neg < 2; ++neg)
+            {
+                // +90 degree around x: (x, y, z) -> (x, -z, y), cyclic for the other axes
+                int8_t turn[3][3] = { 0 };
+                int u = (axis + 1) % 3, v = (axis + 2) % 3;
+                turn[axis][axis] = 1;
+                turn[u][v] = neg ? 1 : -1;
+                turn[v][u] = neg ? -1 : 1;
+                quarterTurn[axis][neg] = (uint8_t)find(turn);
+            }
+    }
+    int find(const int8_t m[3][3]) const
+    {
+        for (int i = 0; i < COUNT; ++i)
+            if (std::memcmp(matrix[i], m, sizeof(matrix[i])) == 0)
+                return i;
+        return -1;
+    }
+};
+
+// largest order supported, so every slot & cubie index fits into 16 bits
+const int CUBE_MAX_ORDER = 32;
+
+// stride between two neighbouring slices of an axis, slot = x + z * n + y * n * n
+constexpr int cubeSliceStride(int n, int axis)
+{
+    return axis == AXIS_X ? 1 : axis == AXIS_Y ? n * n : n;
+}
+
+// Fill the slice tables of an order n cube, usable both at compile time (std::array) and at run time (std::vector).
+// sliceCells[axis * n * n + i] is the slot of cell i of slice 0, the same cell of slice s is that slot + s * stride.
+// turnTarget[(axis * 2 + (dir < 0)) * n * n + i] is the cell that cell i moves to during a quarter turn.
+template<class CellArray, class TargetArray>
+constexpr void buildCubeLayout(int n, CellArray& sliceCells, TargetArray& turnTarget)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        for (int q = 0; q < n; ++q)
+            for (int p = 0; p < n; ++p)
+            {
+                int coord[3] = { 0, 0, 0 };
+                coord[u] = p;
+                coord[v] = q;
+                int cell = p + q * n;
+                sliceCells[axis * n * n + cell] = (uint16_t)(coord[AXIS_X] + coord[AXIS_Z] * n + coord[AXIS_Y] * n * n);
+                // +90 degree maps (u, v) -> (-v, u) around the slice center, -90 degree the other way
+                turnTarget[(axis * 2 + 0) * n * n + cell] = (uint16_t)((n - 1 - q) + p * n);
+                turnTarget[(axis * 2 + 1) * n * n + cell] = (uint16_t)(q + (n - 1 - p) * n);
+            }
+    }
+}
+
+// compile-time slice tables of an order N cube
+template<int N>
+struct CubeLayout
+{
+    std::array<uint16_t, 3 * N * N> sliceCells;
+    std::array<uint16_t, 6 * N * N> turnTarget;
+
+    constexpr CubeLayout() : sliceCells(), turnTarget()
+    {
+        buildCubeLayout(N, sliceCells, turnTarget);
+    }
+};
+
+// slices of one axis turned together, writes the slice moves into moves & returns how many
+// a wide move turns the slices from the outer face nearest to slice up to slice itself, e.g. slice 1 of a 3x3x3
+// along x gives Rw (R & M')
+inline int cubeWideMove(int n, int axis, int slice, int dir, CubeMove* moves)
+{
+    int first = slice < n / 2 ? 0 : slice, last = slice < n / 2 ? slice : n - 1;
+    for (int s = first; s <= last; ++s)
+        moves[s - first] = CubeMove(axis, s, dir);
+    return last - first + 1;
+}
+// a whole-cube rotation turns every slice of the axis
+inline int cubeRotationMove(int n, int axis, int dir, CubeMove* moves)
+{
+    for (int s = 0; s < n; ++s)
+        moves[s] = CubeMove(axis, s, dir);
+    return n;
+}
+
+// turn one slice, touches only the n * n slots of that slice
+template<class CubieId>
+inline void cubeApplyMove(int n, const uint16_t* sliceCells, const uint16_t* turnTarget, CubieId* cubie, uint8_t* orientation,
+                          CubieId* scratchCubie, uint8_t* scratchOrientation, const CubeMove& move)
+{
+    const int sliceSize = n * n;
+    const int base = move.slice * cubeSliceStride(n, move.axis);
+    const uint16_t* cells = sliceCells + move.axis * sliceSize;
+    const uint16_t* target = turnTarget + (move.axis * 2 + (move.dir < 0)) * sliceSize;
+    const CubeRotation& rotations = CubeRotation::get();
+    const uint8_t* turn = rotations.compose[rotations.quarterTurn[move.axis][move.dir < 0]];
+    for (int i = 0; i < sliceSize; ++i)
+    {
+        scratchCubie[target[i]] = cubie[base + cells[i]];
+        scratchOrientation[target[i]] = turn[orientation[base + cells[i]]];
+    }
+    for (int i = 0; i < sliceSize; ++i)
+    {
+        cubie[base + cells[i]] = scratchCubie[i];
+        orientation[base + cells[i]] = scratchOrientation[i];
+    }
+}
+
+// apply a composed move sequence: the permutation cube holds, for every slot, the slot whose cubie the sequence
+// moves there & the rotation that cubie picks up on the way
+template<class CubieId>
+inline void cubeApplyPermutation(int slotCount, const CubieId* permutationCubie, const uint8_t* permutationOrientation,
+                                 const CubieId* cubie, const uint8_t* orientation, CubieId* turnedCubie, uint8_t* turnedOrientation)
+{
+    const CubeRotation& rotations = CubeRotation::get();
+    for (int slot = 0; slot < slotCount; ++slot)
+    {
+        int source = permutationCubie[slot];
+        turnedCubie[slot] = cubie[source];
+        turnedOrientation[slot] = rotations.compose[permutationOrientation[slot]][orientation[source]];
+    }
+}
+
+// FNV-1a over cubies & orientations
+template<class CubieId>
+inline size_t cubeHash(const CubieId* cubie, const uint8_t* orientation, int slotCount)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (int slot = 0; slot < slotCount; ++slot)
+    {
+        h = (h ^ cubie[slot]) * 1099511628211ull;
+        h = (h ^ orientation[slot]) * 1099511628211ull;
+    }
+    return (size_t)h;
+}
+
+// order N cube with all slice tables generated at compile time
+template<int N>
+class Cube
+{
+    static_assert(N >= 2 && N <= CUBE_MAX_ORDER, "unsupported cube order");
+public:
+    static const int ORDER = N;
+    static const int SLOT_COUNT = N * N * N;
+    static const int SLICE_SIZE = N * N;
+    static const int MOVE_COUNT = 3 * N * 2;
+    typedef typename std::conditional<(SLOT_COUNT <= 256), uint8_t, uint16_t>::type CubieId;
+
+    static constexpr CubeLayout<N> layout = CubeLayout<N>();
+
+    // cubie occupying each slot & its orientation (rotation index)
+    std::array<CubieId, SLOT_COUNT> cubie;
+    std::array<uint8_t, SLOT_COUNT> orientation;
+
+    // constructor gives the solved cube
+    Cube()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        for (int slot = 0; slot < SLOT_COUNT; ++slot)
+            cubie[slot] = (CubieId)slot;
+        orientation.fill(CubeRotation::IDENTITY);
+    }
+
+    int order() const
+    {
+        return N;
+    }
+    int slotCount() const
+    {
+        return SLOT_COUNT;
+    }
+    static int slotIndex(int x, int y, int z)
+    {
+        return x + z * N + y * N * N;
+    }
+    static void slotCoord(int slot, int coord[3])
+    {
+        coord[AXIS_X] = slot % N;
+        coord[AXIS_Z] = slot / N % N;
+        coord[AXIS_Y] = slot / (N * N);
+    }
+
+    int cubieAt(int x, int y, int z) const
+    {
+        return cubie[slotIndex(x, y, z)];
+    }
+    int orientationAt(int x, int y, int z) const
+    {
+        return orientation[slotIndex(x, y, z)];
+    }
+
+    void applyMove(const CubeMove& move)
+    {
+        CubieId scratchCubie[SLICE_SIZE];
+        uint8_t scratchOrientation[SLICE_SIZE];
+        cubeApplyMove(N, layout.sliceCells.data(), layout.turnTarget.data(), cubie.data(), orientation.data(),
+                      scratchCubie, scratchOrientation, move);
+    }
+    void applyMoves(const CubeMove* moves, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            applyMove(moves[i]);
+    }
+    // a cube turned from solved by some move sequence is that sequence composed into one permutation,
+    // applying it replays the whole sequence in a single pass over the slots
+    void applyPermutation(const Cube& permutation)
+    {
+        Cube turned;
+        cubeApplyPermutation(SLOT_COUNT, permutation.cubie.data(), permutation.orientation.data(),
+                             cubie.data(), orientation.data(), turned.cubie.data(), turned.orientation.data());
+        *this = turned;
+    }
+
+    bool isSolved() const
+    {
+        return *this == Cube();
+    }
+
+    bool operator==(const Cube& other) const
+    {
+        return cubie == other.cubie && orientation == other.orientation;
+    }
+    bool operator!=(const Cube& other) const
+    {
+        return !(*this == other);
+    }
+
+    size_t hash() const
+    {
+        return cubeHash(cubie.data(), orientation.data(), SLOT_COUNT);
+    }
+};
+
+// the classic 3x3x3 magic cube
+typedef Cube<3> CubeState;
+
+// cube whose order is only known at run time, same interface as Cube<N>
+class DynamicCube
+{
+public:
+    typedef uint16_t CubieId;
+
+    std::vector<CubieId> cubie;
+    std::vector<uint8_t> orientation;
+
+    explicit DynamicCube(int order = 3) : n(order), sliceCells(3 * order * order), turnTarget(6 * order * order),
+        scratchCubie(order * order), scratchOrientation(order * order)
+    {
+        if (order < 2 || order > CUBE_MAX_ORDER)
+            throw std::invalid_argument("unsupported cube order");
+        buildCubeLayout(n, sliceCells, turnTarget);
+        cubie.resize(slotCount());
+        orientation.resize(slotCount());
+        reset();
+    }
+
+    void reset()
+    {
+        for (int slot = 0; slot < slotCount(); ++slot)
+            cubie[slot] = (CubieId)slot;
+        std::fill(orientation.begin(), orientation.end(), (uint8_t)CubeRotation::IDENTITY);
+    }
+
+    int order() const
+    {
+        return n;
+    }
+    int slotCount() const
+    {
+        return n * n * n;
+    }
+    int moveCount() const
+    {
+        return 3 * n * 2;
+    }
+    int slotIndex(int x, int y, int z) const
+    {
+        return x + z * n + y * n * n;
+    }
+    void slotCoord(int slot, int coord[3]) const
+    {
+        coord[AXIS_X] = slot % n;
+        coord[AXIS_Z] = slot / n % n;
+        coord[AXIS_Y] = slot / (n * n);
+    }
+
+    int cubieAt(int x, int y, int z) const
+    {
+        return cubie[slotIndex(x, y, z)];
+    }
+    int orientationAt(int x, int y, int z) const
+    {
+        return orientation[slotIndex(x, y, z)];
+    }
+
+    void applyMove(const CubeMove& move)
+    {
+        cubeApplyMove(n, sliceCells.data(), turnTarget.data(), cubie.data(), orientation.data(),
+                      scratchCubie.data(), scratchOrientation.data(), move);
+    }
+    void applyMoves(const CubeMove* moves, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            applyMove(moves[i]);
+    }
+    void applyPermutation(const DynamicCube& permutation)
+    {
+        if (permutation.n != n)
+            throw std::invalid_argument("permutation of another cube order");
+        std::vector<CubieId> turnedCubie(slotCount());
+        std::vector<uint8_t> turnedOrientation(slotCount());
+        cubeApplyPermutation(slotCount(), permutation.cubie.data(), permutation.orientation.data(),
+                             cubie.data(), orientation.data(), turnedCubie.data(), turnedOrientation.data());
+        cubie.swap(turnedCubie);
+        orientation.swap(turnedOrientation);
+    }
+
+    bool isSolved() const
+    {
+        for (int slot = 0; slot < slotCount(); ++slot)
+            if (cubie[slot] != slot || orientation[slot] != CubeRotation::IDENTITY)
+                return false;
+        return true;
+    }
+
+    bool operator==(const DynamicCube& other) const
+    {
+        return n == other.n && cubie == other.cubie && orientation == other.orientation;
+    }
+    bool operator!=(const DynamicCube& other) const
+    {
+        return !(*this == other);
+    }
+
+    size_t hash() const
+    {
+        return cubeHash(cubie.data(), orientation.data(), slotCount());
+    }
+
+private:
+    int n;
+    std::vector<uint16_t> sliceCells;
+    std::vector<uint16_t> turnTarget;
+    std::vector<CubieId> scratchCubie;
+    std::vector<uint8_t> scratchOrientation;
+};
+
+// hash functor for unordered containers of Cube<N> / DynamicCube
+struct CubeStateHash
+{
+    template<class CubeType>
+    size_t operator()(const CubeType& state) const
+    {
+        return state.hash();
+    }
+};
+
+namespace std
+{
+    template<int N> struct hash<Cube<N>>
+    {
+        size_t operator()(const Cube<N>& state) const
+        {
+            return state.hash();
+        }
+    };
+    template<> struct hash<DynamicCube>
+    {
+        size_t operator()(const DynamicCube& state) const
+        {
+            return state.hash();
+        }
+    };
+}
+#endif
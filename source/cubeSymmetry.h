@@ -0,0 +1,247 @@
+#ifndef CUBE_SYMMETRY_H
+#define CUBE_SYMMETRY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cubieCube.h"
+#include "tableFile.h"
+
+// The 48 spatial symmetries of the cube (24 rotations, each with & without a reflection) as cubie cubes.
+//
+// sym = 16 * urf3 + 8 * f2 + 2 * u4 + lr2, built from the 120 degree rotation around the URF-DBL diagonal,
+// the 180 degree rotation around the F axis, the 90 degree rotation around the U axis & the left-right
+// reflection. The first 16 keep the UD axis in place & map the phase 2 moves onto phase 2 moves.
+// A reflected corner carries its twist as 3 - 5, multiply() below handles both kinds.
+const int SYM_COUNT = 48;
+const int SYM_UD_COUNT = 16;
+
+// a * b for cubes that may contain reflections
+inline CubieCube symMultiply(const CubieCube& a, const CubieCube& b)
+{
+    CubieCube product;
+    for (int i = 0; i < 8; ++i)
+    {
+        int twistA = a.co[b.cp[i]], twistB = b.co[i], twist;
+        if (twistA < 3 && twistB < 3)
+            twist = (twistA + twistB) % 3;
+        else if (twistA < 3)
+            twist = twistA + twistB >= 6 ? twistA + twistB - 3 : twistA + twistB;
+        else if (twistB < 3)
+            twist = twistA - twistB < 3 ? twistA - twistB + 3 : twistA - twistB;
+        else
+            twist = twistA - twistB < 0 ? twistA - twistB + 3 : twistA - twistB;
+        product.cp[i] = a.cp[b.cp[i]];
+        product.co[i] = (uint8_t)twist;
+    }
+    for (int i = 0; i < 12; ++i)
+    {
+        product.ep[i] = a.ep[b.ep[i]];
+        product.eo[i] = (uint8_t)(a.eo[b.ep[i]] ^ b.eo[i]);
+    }
+    return product;
+}
+
+class CubeSymmetry
+{
+public:
+    CubieCube cube[SYM_COUNT];
+    uint8_t inverse[SYM_COUNT];
+    // conjugate of each face move, moveConjugate[sym][move] = sym * move * sym^-1
+    uint8_t moveConjugate[SYM_COUNT][FACE_MOVE_COUNT];
+
+    static const CubeSymmetry& get()
+    {
+        static const CubeSymmetry table;
+        return table;
+    }
+
+    // sym * cube * sym^-1, the cube as seen through the symmetry
+    CubieCube conjugate(const CubieCube& state, int sym) const
+    {
+        return symMultiply(symMultiply(cube[sym], state), cube[inverse[sym]]);
+    }
+
+private:
+    CubeSymmetry()
+    {
+        CubieCube urf3, f2, u4, lr2;
+        static const uint8_t urf3Corner[8] = { CORNER_URF, CORNER_DFR, CORNER_DLF, CORNER_UFL, CORNER_UBR, CORNER_DRB, CORNER_DBL, CORNER_ULB };
+        static const uint8_t urf3Twist[8] = { 1, 2, 1, 2, 2, 1, 2, 1 };
+        static const uint8_t urf3Edge[12] = { EDGE_UF, EDGE_FR, EDGE_DF, EDGE_FL, EDGE_UB, EDGE_BR, EDGE_DB, EDGE_BL, EDGE_UR, EDGE_DR, EDGE_DL, EDGE_UL };
+        static const uint8_t urf3Flip[12] = { 1, 0, 1, 0, 1, 0, 1, 0, 1, 1, 1, 1 };
+        static const uint8_t f2Corner[8] = { CORNER_DLF, CORNER_DFR, CORNER_DRB, CORNER_DBL, CORNER_UFL, CORNER_URF, CORNER_UBR, CORNER_ULB };
+        static const uint8_t f2Edge[12] = { EDGE_DL, EDGE_DF, EDGE_DR, EDGE_DB, EDGE_UL, EDGE_UF, EDGE_UR, EDGE_UB, EDGE_FL, EDGE_FR, EDGE_BR, EDGE_BL };
+        static const uint8_t u4Corner[8] = { CORNER_UBR, CORNER_URF, CORNER_UFL, CORNER_ULB, CORNER_DRB, CORNER_DFR, CORNER_DLF, CORNER_DBL };
+        static const uint8_t u4Edge[12] = { EDGE_UB, EDGE_UR, EDGE_UF, EDGE_UL, EDGE_DB, EDGE_DR, EDGE_DF, EDGE_DL, EDGE_BR, EDGE_FR, EDGE_FL, EDGE_BL };
+        static const uint8_t lr2Corner[8] = { CORNER_UFL, CORNER_URF, CORNER_UBR, CORNER_ULB, CORNER_DLF, CORNER_DFR, CORNER_DRB, CORNER_DBL };
+        static const uint8_t lr2Edge[12] = { EDGE_UL, EDGE_UF, EDGE_UR, EDGE_UB, EDGE_DL, EDGE_DF, EDGE_DR, EDGE_DB, EDGE_FL, EDGE_FR, EDGE_BR, EDGE_BL };
+        for (int i = 0; i < 8; ++i)
+        {
+            urf3.cp[i] = urf3Corner[i];
+            urf3.co[i] = urf3Twist[i];
+            f2.cp[i] = f2Corner[i];
+            u4.cp[i] = u4Corner[i];
+            lr2.cp[i] = lr2Corner[i];
+            lr2.co[i] = 3;
+        }
+        for (int i = 0; i < 12; ++i)
+        {
+            urf3.ep[i] = urf3Edge[i];
+            urf3.eo[i] = urf3Flip[i];
+            f2.ep[i] = f2Edge[i];
+            u4.ep[i] = u4Edge[i];
+            u4.eo[i] = i >= EDGE_FR;
+            lr2.ep[i] = lr2Edge[i];
+        }
+
+        CubieCube current;
+        int sym = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 2; ++j)
+            {
+                for (int k = 0; k < 4; ++k)
+                {
+                    for (int l = 0; l < 2; ++l)
+                    {
+                        cube[sym++] = current;
+                        current = symMultiply(current, lr2);
+                    }
+                    current = symMultiply(current, u4);
+                }
+                current = symMultiply(current, f2);
+            }
+            current = symMultiply(current, urf3);
+        }
+        for (int a = 0; a < SYM_COUNT; ++a)
+            for (int b = 0; b < SYM_COUNT; ++b)
+                if (symMultiply(cube[a], cube[b]) == CubieCube())
+                    inverse[a] = (uint8_t)b;
+        for (int s = 0; s < SYM_COUNT; ++s)
+            for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+            {
+                CubieCube conjugated = conjugate(CubieCube::move(m), s);
+                for (int n = 0; n < FACE_MOVE_COUNT; ++n)
+                    if (conjugated == CubieCube::move(n))
+                        moveConjugate[s][m] = (uint8_t)n;
+            }
+    }
+};
+
+// A raw coordinate reduced to its classes under the first symCount symmetries.
+// classSym[raw] packs class << 8 | sym with conjugate(raw, sym) = representative[class], selfSymmetry[class] has
+// bit s set for every symmetry that maps the representative onto itself.
+// All three tables are kept in table files (see tableFile.h).
+class SymCoordinate
+{
+public:
+    TableArray<uint32_t> classSym;
+    TableArray<uint32_t> representative;
+    TableArray<uint64_t> selfSymmetry;
+
+    int classOf(int raw) const
+    {
+        return (int)(classSym[raw] >> 8);
+    }
+    int symOf(int raw) const
+    {
+        return (int)(classSym[raw] & 0xff);
+    }
+    int classCount() const
+    {
+        return (int)representative.size();
+    }
+
+    // conjugateRaw(raw, sym) gives the raw coordinate of sym * cube * sym^-1 for a cube with coordinate raw
+    template<class ConjugateRaw>
+    void loadOrGenerate(const char* name, int rawCount, int symCount, ConjugateRaw conjugateRaw)
+    {
+        const std::string prefix = name;
+        std::vector<uint32_t> classes;
+        std::vector<uint32_t> representatives;
+        std::vector<uint64_t> selfSymmetries;
+        // the class count is only known after the classes are found, so the tables come from one pass
+        bool generated = false;
+        auto generate = [&]()
+        {
+            if (generated)
+                return;
+            generated = true;
+            const CubeSymmetry& symmetry = CubeSymmetry::get();
+            classes.assign(rawCount, ~0u);
+            for (int raw = 0; raw < rawCount; ++raw)
+            {
+                if (classes[raw] != ~0u)
+                    continue;
+                uint32_t cls = (uint32_t)representatives.size();
+                uint64_t self = 0;
+                representatives.push_back((uint32_t)raw);
+                for (int s = 0; s < symCount; ++s)
+                {
+                    int image = conjugateRaw(raw, s);
+                    if (image == raw)
+                        self |= 1ull << s;
+                    if (classes[image] == ~0u)
+                        classes[image] = cls << 8 | symmetry.inverse[s];
+                }
+                selfSymmetries.push_back(self);
+            }
+        };
+        classSym.loadOrGenerate((prefix + "_class_sym").c_str(), rawCount, [&](std::vector<uint32_t>& table)
+        {
+            generate();
+            table = classes;
+        });
+        // a mapped class table means the class count is whatever the stored representatives say
+        size_t count = representatives.size();
+        if (!generated)
+        {
+            uint32_t last = 0;
+            for (int raw = 0; raw < rawCount; ++raw)
+                last = std::max(last, classSym[raw] >> 8);
+            count = last + 1;
+        }
+        representative.loadOrGenerate((prefix + "_representative").c_str(), count, [&](std::vector<uint32_t>& table)
+        {
+            generate();
+            table = representatives;
+        });
+        selfSymmetry.loadOrGenerate((prefix + "_self_symmetry").c_str(), count, [&](std::vector<uint64_t>& table)
+        {
+            generate();
+            table = selfSymmetries;
+        });
+    }
+};
+
+// twist of sym * cube * sym^-1 at twist * SYM_UD_COUNT + sym. Only the UD symmetries leave the corners' twist
+// independent of their permutation, so this is what pairs a symmetry reduced coordinate with the twist.
+inline void loadTwistConjugateTable(TableArray<uint16_t>& table)
+{
+    table.loadOrGenerate("twist_conjugate", (size_t)2187 * SYM_UD_COUNT, [](std::vector<uint16_t>& values)
+    {
+        const CubeSymmetry& symmetry = CubeSymmetry::get();
+        for (int twist = 0; twist < 2187; ++twist)
+        {
+            CubieCube cube;
+            cube.setTwist(twist);
+            for (int s = 0; s < SYM_UD_COUNT; ++s)
+                values[twist * SYM_UD_COUNT + s] = (uint16_t)symmetry.conjugate(cube, s).twist();
+        }
+    });
+}
+
+// corner permutation reduced by the UD symmetries, 2768 classes
+inline void loadCornerPermSymmetry(SymCoordinate& coordinate)
+{
+    coordinate.loadOrGenerate("corner_perm_sym", 40320, SYM_UD_COUNT, [](int perm, int sym)
+    {
+        CubieCube cube;
+        cube.setCornerPerm(perm);
+        return CubeSymmetry::get().conjugate(cube, sym).cornerPerm();
+    });
+}
+#endif
@@ -0,0 +1,416 @@
+#ifndef CUBIE_CUBE_H
+#define CUBIE_CUBE_H
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "cubeState.h"
+#include "tableFile.h"
+
+// Cubie level model of the 3x3x3 cube used by the solvers: which corner / edge sits at each corner / edge
+// position & how it is twisted, with the centers fixed. Positions, faces & moves follow Kociemba's
+// conventions so the usual coordinates (twist, flip, UD slice, ...) apply.
+
+// faces in the order of the 18 face moves, move = face * 3 + power - 1 (U, U2, U', R, ...)
+enum CubeFace
+{
+    SIDE_U = 0,
+    SIDE_R = 1,
+    SIDE_F = 2,
+    SIDE_D = 3,
+    SIDE_L = 4,
+    SIDE_B = 5
+};
+
+enum CubeCorner
+{
+    CORNER_URF = 0, CORNER_UFL, CORNER_ULB, CORNER_UBR, CORNER_DFR, CORNER_DLF, CORNER_DBL, CORNER_DRB
+};
+
+enum CubeEdge
+{
+    EDGE_UR = 0, EDGE_UF, EDGE_UL, EDGE_UB, EDGE_DR, EDGE_DF, EDGE_DL, EDGE_DB, EDGE_FR, EDGE_FL, EDGE_BL, EDGE_BR
+};
+
+const int FACE_MOVE_COUNT = 18;
+
+// outward normal of each face in the axes of CubeState, U = +y, R = +x, F = +z
+const int sideDirection[6][3] = { { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 }, { 0, -1, 0 }, { -1, 0, 0 }, { 0, 0, -1 } };
+// faces of each corner / edge position, clockwise for corners, U / D (or F / B for slice edges) first
+const int cornerSides[8][3] = {
+    { SIDE_U, SIDE_R, SIDE_F }, { SIDE_U, SIDE_F, SIDE_L }, { SIDE_U, SIDE_L, SIDE_B }, { SIDE_U, SIDE_B, SIDE_R },
+    { SIDE_D, SIDE_F, SIDE_R }, { SIDE_D, SIDE_L, SIDE_F }, { SIDE_D, SIDE_B, SIDE_L }, { SIDE_D, SIDE_R, SIDE_B }
+};
+const int edgeSides[12][2] = {
+    { SIDE_U, SIDE_R }, { SIDE_U, SIDE_F }, { SIDE_U, SIDE_L }, { SIDE_U, SIDE_B }, { SIDE_D, SIDE_R }, { SIDE_D, SIDE_F },
+    { SIDE_D, SIDE_L }, { SIDE_D, SIDE_B }, { SIDE_F, SIDE_R }, { SIDE_F, SIDE_L }, { SIDE_B, SIDE_L }, { SIDE_B, SIDE_R }
+};
+
+// binomial coefficient, 0 when k > n
+inline int binomial(int n, int k)
+{
+    if (k < 0 || k > n)
+        return 0;
+    int result = 1;
+    for (int i = 0; i < k; ++i)
+        result = result * (n - i) / (i + 1);
+    return result;
+}
+
+// notation of a face move, e.g. "R'"
+inline const char* faceMoveName(int move)
+{
+    static const char* names[FACE_MOVE_COUNT] = {
+        "U", "U2", "U'", "R", "R2", "R'", "F", "F2", "F'", "D", "D2", "D'", "L", "L2", "L'", "B", "B2", "B'"
+    };
+    return names[move];
+}
+
+// slice moves of CubeState turning the face move, seen from a cube whose core is rotated by frame
+// (the orientation of the center cubie), returns the number of quarter turns written (1 or 2)
+inline int faceMoveToCubeMoves(int move, int frame, CubeMove* moves)
+{
+    int direction[3];
+    CubeRotation::get().apply(frame, sideDirection[move / 3], direction);
+    int axis = direction[AXIS_X] ? AXIS_X : direction[AXIS_Y] ? AXIS_Y : AXIS_Z;
+    // clockwise seen from outside the face is -90 degree around its outward normal
+    CubeMove quarter = direction[axis] > 0 ? CubeMove(axis, 2, -1) : CubeMove(axis, 0, 1);
+    int power = move % 3 + 1;
+    if (power == 3)
+        quarter = quarter.inverse();
+    moves[0] = quarter;
+    moves[1] = quarter;
+    return power == 2 ? 2 : 1;
+}
+
+class CubieCube
+{
+public:
+    uint8_t cp[8];  // corner at each corner position
+    uint8_t co[8];  // twist of that corner, 0 - 2
+    uint8_t ep[12]; // edge at each edge position
+    uint8_t eo[12]; // flip of that edge, 0 - 1
+
+    // constructor gives the solved cube
+    CubieCube()
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            cp[i] = (uint8_t)i;
+            co[i] = 0;
+        }
+        for (int i = 0; i < 12; ++i)
+        {
+            ep[i] = (uint8_t)i;
+            eo[i] = 0;
+        }
+    }
+
+    // read the corners & edges of a 3x3x3 cube state, seen from its centers.
+    // frame receives the rotation of the core, needed to turn face moves back into slice moves
+    static CubieCube fromCube(const CubeState& cube, int& frame)
+    {
+        const CubeRotation& rotations = CubeRotation::get();
+        frame = cube.orientation[CubeState::slotIndex(1, 1, 1)];
+        const int unframe = rotations.inverse[frame];
+        CubieCube result;
+        for (int i = 0; i < 8; ++i)
+        {
+            int slot = slotOf(cornerSides[i], 3, frame);
+            int piece = cornerAt(cube.cubie[slot]);
+            int orientation = rotations.compose[unframe][cube.orientation[slot]];
+            int turned[3];
+            rotations.apply(orientation, sideDirection[cornerSides[piece][0]], turned);
+            result.cp[i] = (uint8_t)piece;
+            for (int k = 0; k < 3; ++k)
+                if (std::memcmp(turned, sideDirection[cornerSides[i][k]], sizeof(turned)) == 0)
+                    result.co[i] = (uint8_t)k;
+        }
+        for (int i = 0; i < 12; ++i)
+        {
+            int slot = slotOf(edgeSides[i], 2, frame);
+            int piece = edgeAt(cube.cubie[slot]);
+            int orientation = rotations.compose[unframe][cube.orientation[slot]];
+            int turned[3];
+            rotations.apply(orientation, sideDirection[edgeSides[piece][0]], turned);
+            result.ep[i] = (uint8_t)piece;
+            result.eo[i] = std::memcmp(turned, sideDirection[edgeSides[i][0]], sizeof(turned)) != 0;
+        }
+        return result;
+    }
+
+    // the cube after face move m of the solved cube
+    static const CubieCube& move(int m)
+    {
+        static const std::array<CubieCube, FACE_MOVE_COUNT> table = buildMoves();
+        return table[m];
+    }
+
+    // this = this * other, i.e. apply other after this
+    void multiply(const CubieCube& other)
+    {
+        CubieCube product;
+        for (int i = 0; i < 8; ++i)
+        {
+            product.cp[i] = cp[other.cp[i]];
+            product.co[i] = (uint8_t)((co[other.cp[i]] + other.co[i]) % 3);
+        }
+        for (int i = 0; i < 12; ++i)
+        {
+            product.ep[i] = ep[other.ep[i]];
+            product.eo[i] = (uint8_t)(eo[other.ep[i]] ^ other.eo[i]);
+        }
+        *this = product;
+    }
+    void applyMove(int m)
+    {
+        multiply(move(m));
+    }
+
+    bool operator==(const CubieCube& other) const
+    {
+        return std::memcmp(this, &other, sizeof(CubieCube)) == 0;
+    }
+    bool operator!=(const CubieCube& other) const
+    {
+        return !(*this == other);
+    }
+
+    // coordinates
+    // -----------
+    // corner twist, 0 - 2186
+    int twist() const
+    {
+        int result = 0;
+        for (int i = 0; i < 7; ++i)
+            result = result * 3 + co[i];
+        return result;
+    }
+    void setTwist(int twist)
+    {
+        int sum = 0;
+        for (int i = 6; i >= 0; --i)
+        {
+            co[i] = (uint8_t)(twist % 3);
+            sum += co[i];
+            twist /= 3;
+        }
+        co[7] = (uint8_t)((3 - sum % 3) % 3);
+    }
+    // edge flip, 0 - 2047
+    int flip() const
+    {
+        int result = 0;
+        for (int i = 0; i < 11; ++i)
+            result = result * 2 + eo[i];
+        return result;
+    }
+    void setFlip(int flip)
+    {
+        int sum = 0;
+        for (int i = 10; i >= 0; --i)
+        {
+            eo[i] = (uint8_t)(flip & 1);
+            sum += eo[i];
+            flip >>= 1;
+        }
+        eo[11] = (uint8_t)(sum & 1);
+    }
+    // positions & order of the 4 UD slice edges, 0 - 11879. sliceSorted / 24 is 0 exactly when they are all in
+    // the slice, sliceSorted % 24 is then their permutation
+    int sliceSorted() const
+    {
+        int a = 0, x = 0;
+        uint8_t edge4[4];
+        for (int j = EDGE_BR; j >= EDGE_UR; --j)
+            if (ep[j] >= EDGE_FR)
+            {
+                a += binomial(11 - j, x + 1);
+                edge4[3 - x] = ep[j];
+                ++x;
+            }
+        int b = 0;
+        for (int j = 3; j > 0; --j)
+        {
+            int k = 0;
+            while (edge4[j] != j + EDGE_FR)
+            {
+                rotateLeft(edge4, j);
+                ++k;
+            }
+            b = (j + 1) * b + k;
+        }
+        return 24 * a + b;
+    }
+    void setSliceSorted(int index)
+    {
+        uint8_t sliceEdge[4] = { EDGE_FR, EDGE_FL, EDGE_BL, EDGE_BR };
+        int b = index % 24, a = index / 24;
+        for (int j = 1; j < 4; ++j)
+        {
+            int k = b % (j + 1);
+            b /= j + 1;
+            while (k-- > 0)
+                rotateRight(sliceEdge, j);
+        }
+        int x = 4;
+        for (int j = 0; j < 12; ++j)
+        {
+            ep[j] = 0xff;
+            if (x > 0 && a - binomial(11 - j, x) >= 0)
+            {
+                ep[j] = sliceEdge[4 - x];
+                a -= binomial(11 - j, x);
+                --x;
+            }
+        }
+        int other = EDGE_UR;
+        for (int j = 0; j < 12; ++j)
+            if (ep[j] == 0xff)
+                ep[j] = (uint8_t)other++;
+    }
+    // corner permutation, 0 - 40319
+    int cornerPerm() const
+    {
+        return permutationIndex(cp, 8);
+    }
+    void setCornerPerm(int index)
+    {
+        setPermutation(cp, 8, index);
+    }
+    // permutation of the 8 U & D edges, 0 - 40319, only meaningful when they are all in the U & D faces
+    int udEdgePerm() const
+    {
+        return permutationIndex(ep, 8);
+    }
+    void setUdEdgePerm(int index)
+    {
+        setPermutation(ep, 8, index);
+        for (int i = 8; i < 12; ++i)
+            ep[i] = (uint8_t)i;
+    }
+
+private:
+    // derived from the slice moves of CubeState so both models always agree
+    static std::array<CubieCube, FACE_MOVE_COUNT> buildMoves()
+    {
+        std::array<CubieCube, FACE_MOVE_COUNT> table;
+        for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+        {
+            CubeState state;
+            CubeMove moves[2];
+            state.applyMoves(moves, faceMoveToCubeMoves(m, CubeRotation::IDENTITY, moves));
+            int frame;
+            table[m] = fromCube(state, frame);
+        }
+        return table;
+    }
+
+    // slot of the position with the given faces, seen through frame
+    static int slotOf(const int* sides, int count, int frame)
+    {
+        int position[3] = { 0, 0, 0 };
+        for (int k = 0; k < count; ++k)
+            for (int c = 0; c < 3; ++c)
+                position[c] += sideDirection[sides[k]][c];
+        int turned[3];
+        CubeRotation::get().apply(frame, position, turned);
+        return CubeState::slotIndex(turned[AXIS_X] + 1, turned[AXIS_Y] + 1, turned[AXIS_Z] + 1);
+    }
+    // corner / edge whose home is the given slot
+    static int cornerAt(int homeSlot)
+    {
+        for (int i = 0; i < 8; ++i)
+            if (slotOf(cornerSides[i], 3, CubeRotation::IDENTITY) == homeSlot)
+                return i;
+        return -1;
+    }
+    static int edgeAt(int homeSlot)
+    {
+        for (int i = 0; i < 12; ++i)
+            if (slotOf(edgeSides[i], 2, CubeRotation::IDENTITY) == homeSlot)
+                return i;
+        return -1;
+    }
+
+    static void rotateLeft(uint8_t* values, int last)
+    {
+        uint8_t first = values[0];
+        for (int i = 0; i < last; ++i)
+            values[i] = values[i + 1];
+        values[last] = first;
+    }
+    static void rotateRight(uint8_t* values, int last)
+    {
+        uint8_t end = values[last];
+        for (int i = last; i > 0; --i)
+            values[i] = values[i - 1];
+        values[0] = end;
+    }
+    static int permutationIndex(const uint8_t* values, int count)
+    {
+        uint8_t perm[12];
+        std::memcpy(perm, values, count);
+        int index = 0;
+        for (int j = count - 1; j > 0; --j)
+        {
+            int k = 0;
+            while (perm[j] != j)
+            {
+                rotateLeft(perm, j);
+                ++k;
+            }
+            index = (j + 1) * index + k;
+        }
+        return index;
+    }
+    static void setPermutation(uint8_t* values, int count, int index)
+    {
+        for (int i = 0; i < count; ++i)
+            values[i] = (uint8_t)i;
+        for (int j = 0; j < count; ++j)
+        {
+            int k = index % (j + 1);
+            index /= j + 1;
+            while (k-- > 0)
+                rotateRight(values, j);
+        }
+    }
+};
+// move table of a coordinate, table[coord * FACE_MOVE_COUNT + move], moves rejected by allowed are left 0
+inline bool anyFaceMove(int)
+{
+    return true;
+}
+template<class Coord>
+inline void buildMoveTable(std::vector<Coord>& table, int count, void (CubieCube::*set)(int), int (CubieCube::*get)() const,
+                           bool (*allowed)(int) = anyFaceMove)
+{
+    table.assign((size_t)count * FACE_MOVE_COUNT, 0);
+    for (int coord = 0; coord < count; ++coord)
+    {
+        CubieCube cube;
+        (cube.*set)(coord);
+        for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+        {
+            if (!allowed(m))
+                continue;
+            CubieCube turned = cube;
+            turned.applyMove(m);
+            table[(size_t)coord * FACE_MOVE_COUNT + m] = (Coord)(turned.*get)();
+        }
+    }
+}
+// same, kept in the table file <tableDirectory()>/<name>.tab
+template<class Coord>
+inline void loadMoveTable(TableArray<Coord>& table, const char* name, int count, void (CubieCube::*set)(int),
+                          int (CubieCube::*get)() const, bool (*allowed)(int) = anyFaceMove)
+{
+    table.loadOrGenerate(name, (size_t)count * FACE_MOVE_COUNT, [=](std::vector<Coord>& values)
+    {
+        buildMoveTable(values, count, set, get, allowed);
+    });
+}
+#endif
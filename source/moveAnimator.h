@@ -0,0 +1,193 @@
+#ifndef MOVE_ANIMATOR_H
+#define MOVE_ANIMATOR_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "cubeState.h"
+
+// Plays queued moves as eased quarter-turn animations.
+//
+// Any number of moves can be queued. A move starts as soon as it commutes with every move still
+// animating (same axis, different slice), so e.g. R L' turn together; otherwise it waits for them
+// to settle. Moves queued together (wide moves, whole-cube rotations) always start at the same
+// time, every slice with its own angle. The duration of a turn shrinks with the queue depth so that
+// playing back the whole queue stays within playbackBudget seconds. Finished moves are handed back
+// in update() so the caller applies them to its cube state.
+// In turbo mode only the last turboTail moves are animated, everything queued before them is
+// handed back in one batch per frame so that the caller can simplify it before applying it.
+class MoveAnimator
+{
+public:
+    struct Animation
+    {
+        CubeMove move;
+        double progress;    // [0, 1]
+        double duration;    // seconds
+    };
+
+    // seconds for a single quarter turn when the queue is short
+    double turnDuration;
+    // shortest duration a turn gets when the queue is long
+    double minTurnDuration;
+    // wall-clock seconds the whole queue should take to play back
+    double playbackBudget;
+    // skip the animation of all but the last turboTail queued moves
+    bool turbo;
+    size_t turboTail;
+
+    MoveAnimator(double turnDuration = 1.0, double minTurnDuration = 0.02, double playbackBudget = 10.0)
+        : turnDuration(turnDuration), minTurnDuration(minTurnDuration), playbackBudget(playbackBudget),
+          turbo(false), turboTail(8), pendingJoined(0) {}
+
+    void enqueue(const CubeMove& move)
+    {
+        pending.push_back(QueuedMove{ move, false });
+    }
+    void enqueue(const CubeMove* moves, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            enqueue(moves[i]);
+    }
+    // moves turning different slices of one axis, animated as a single turn
+    void enqueueTogether(const CubeMove* moves, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            pending.push_back(QueuedMove{ moves[i], i > 0 });
+        if (count > 1)
+            pendingJoined += count - 1;
+    }
+
+    bool busy() const
+    {
+        return !pending.empty() || !active.empty();
+    }
+    size_t queued() const
+    {
+        return pending.size();
+    }
+    const std::vector<Animation>& animations() const
+    {
+        return active;
+    }
+
+    // advance the animations by dt seconds, apply(move) is called for every move that finished
+    template<class ApplyMove>
+    void update(double dt, ApplyMove apply)
+    {
+        update(dt, apply, [&apply](const CubeMove* moves, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+                apply(moves[i]);
+        });
+    }
+    // same, in turbo mode the skipped moves are handed to applyBatch(moves, count) in queue order
+    template<class ApplyMove, class ApplyBatch>
+    void update(double dt, ApplyMove apply, ApplyBatch applyBatch)
+    {
+        if (turbo && pending.size() > turboTail)
+        {
+            // running turns come first in the queue order, finish them at once
+            for (const Animation& animation : active)
+                batch.push_back(animation.move);
+            active.clear();
+            // never split a group queued together, part of it would jump while the rest animates
+            size_t skipped = pending.size() - turboTail;
+            while (skipped < pending.size() && pending[skipped].withPrevious)
+                ++skipped;
+            for (size_t i = 0; i < skipped; ++i)
+            {
+                batch.push_back(pending.front().move);
+                pendingJoined -= pending.front().withPrevious;
+                pending.pop_front();
+            }
+            applyBatch(batch.data(), batch.size());
+            batch.clear();
+        }
+        for (size_t i = 0; i < active.size();)
+        {
+            Animation& animation = active[i];
+            animation.progress += dt / animation.duration;
+            if (animation.progress >= 1.0)
+            {
+                apply(animation.move);
+                active.erase(active.begin() + i);
+            }
+            else
+                ++i;
+        }
+        startCommuting();
+    }
+
+    // axis of the running animations (-1 if none) & current angle of each slice in radian
+    int sliceAngles(float* angles, int order) const
+    {
+        for (int slice = 0; slice < order; ++slice)
+            angles[slice] = 0.0f;
+        if (active.empty())
+            return -1;
+        for (const Animation& animation : active)
+        {
+            // smoothstep easing
+            double t = animation.progress;
+            double eased = t * t * (3.0 - 2.0 * t);
+            angles[animation.move.slice] = (float)(animation.move.dir * eased * 1.5707963267948966);
+        }
+        return active.front().move.axis;
+    }
+
+private:
+    struct QueuedMove
+    {
+        CubeMove move;
+        bool withPrevious;  // starts together with the move queued before it
+    };
+
+    std::deque<QueuedMove> pending;
+    // queued moves that join the previous one, pending.size() - pendingJoined turns are left
+    size_t pendingJoined;
+    std::vector<Animation> active;
+    // scratch for the moves skipped in turbo mode
+    std::vector<CubeMove> batch;
+
+    // a move may start while others animate only if it turns another slice of the same axis
+    bool commutesWithActive(const CubeMove& move) const
+    {
+        for (const Animation& animation : active)
+            if (animation.move.axis != move.axis || animation.move.slice == move.slice)
+                return false;
+        return true;
+    }
+
+    // start the turns at the front of the queue as long as every move of the turn commutes
+    void startCommuting()
+    {
+        while (!pending.empty())
+        {
+            size_t count = 1;
+            while (count < pending.size() && pending[count].withPrevious)
+                ++count;
+            for (size_t i = 0; i < count; ++i)
+                if (!commutesWithActive(pending[i].move))
+                    return;
+            // spread the remaining budget over every turn not started yet
+            double duration = playbackBudget / (double)(pending.size() - pendingJoined);
+            if (duration > turnDuration)
+                duration = turnDuration;
+            if (duration < minTurnDuration)
+                duration = minTurnDuration;
+            for (size_t i = 0; i < count; ++i)
+            {
+                Animation animation;
+                animation.move = pending.front().move;
+                animation.progress = 0.0;
+                animation.duration = duration;
+                active.push_back(animation);
+                pendingJoined -= pending.front().withPrevious;
+                pending.pop_front();
+            }
+        }
+    }
+};
+#endif
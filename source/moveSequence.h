@@ -0,0 +1,293 @@
+#ifndef MOVE_SEQUENCE_H
+#define MOVE_SEQUENCE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cubeState.h"
+#include "cubieCube.h"
+#include "packedCube.h"
+
+// Move sequence compiler: notation in, canonical minimal sequence out, optionally composed into one permutation.
+//
+// Moves on one axis commute whatever their slices, so a run of consecutive moves on one axis only matters through
+// its net turn (modulo 4) per slice. Simplifying rewrites every such run to that net turn in a fixed slice order,
+// runs that turn into nothing disappear & let their neighbours merge (R U U' R' gives nothing, U D U' gives D).
+// The result has no two runs on the same axis next to each other & no slice turned twice within a run, so it is
+// canonical: sequences that only differ by these rewrites compile to the same moves.
+
+// Run-merging core shared by both move kinds. Every move is slot (of slotCount per axis) & quarter turns (1 - 3)
+// on axis, describe(move, axis, slot, quarters) reads a move, emit(axis, slot, quarters, out) appends the canonical
+// moves of a net turn.
+template<class Move, class Describe, class Emit>
+void simplifyMoveRuns(std::vector<Move>& moves, int slotCount, Describe describe, Emit emit)
+{
+    std::vector<Move> out;
+    std::vector<int> net(slotCount);
+    // out[runStart, end) is the trailing run of moves on one axis
+    size_t runStart = 0;
+    for (const Move& move : moves)
+    {
+        int axis, slot, quarters;
+        describe(move, axis, slot, quarters);
+        int lastAxis = -1;
+        if (!out.empty())
+        {
+            int s, q;
+            describe(out.back(), lastAxis, s, q);
+        }
+        if (lastAxis != axis)
+        {
+            runStart = out.size();
+            emit(axis, slot, quarters, out);
+            continue;
+        }
+        // fold the move into the trailing run & rewrite the run
+        std::fill(net.begin(), net.end(), 0);
+        for (size_t i = runStart; i < out.size(); ++i)
+        {
+            int a, s, q;
+            describe(out[i], a, s, q);
+            net[s] += q;
+        }
+        net[slot] += quarters;
+        out.resize(runStart);
+        for (int s = 0; s < slotCount; ++s)
+            if (net[s] % 4)
+                emit(axis, s, net[s] % 4, out);
+        if (out.size() > runStart)
+            continue;
+        // the run vanished, the run before it is the trailing one now
+        runStart = out.size();
+        if (!out.empty())
+        {
+            int tailAxis, s, q;
+            describe(out.back(), tailAxis, s, q);
+            while (runStart > 0)
+            {
+                int a;
+                describe(out[runStart - 1], a, s, q);
+                if (a != tailAxis)
+                    break;
+                --runStart;
+            }
+        }
+    }
+    moves.swap(out);
+}
+
+// Face moves (see faceMoveName()): of two opposite faces U comes before D, R before L & F before B, the order the
+// solvers search in.
+inline void simplifyFaceMoves(std::vector<int>& moves)
+{
+    simplifyMoveRuns(moves, 2, [](int move, int& axis, int& slot, int& quarters)
+    {
+        axis = move / 3 % 3;
+        slot = move / 3 / 3;
+        quarters = move % 3 + 1;
+    }, [](int axis, int slot, int quarters, std::vector<int>& out)
+    {
+        out.push_back((slot * 3 + axis) * 3 + quarters - 1);
+    });
+}
+
+// Slice moves of an order n cube: slices in increasing order, a quarter turn as one +-90 degree move, a half turn as
+// two +90 degree moves (the quarter turns CubeMove & the animation queue work in).
+inline void simplifyCubeMoves(std::vector<CubeMove>& moves, int n)
+{
+    simplifyMoveRuns(moves, n, [](const CubeMove& move, int& axis, int& slot, int& quarters)
+    {
+        axis = move.axis;
+        slot = move.slice;
+        quarters = move.dir > 0 ? 1 : 3;
+    }, [](int axis, int slot, int quarters, std::vector<CubeMove>& out)
+    {
+        if (quarters == 3)
+            out.push_back(CubeMove(axis, slot, -1));
+        else
+            for (int i = 0; i < quarters; ++i)
+                out.push_back(CubeMove(axis, slot, 1));
+    });
+}
+
+// one move of the notation: slices first - last of axis, each turned turns quarter turns in direction dir
+struct NotatedMove
+{
+    int axis;
+    int first;
+    int last;
+    int dir;
+    int turns;
+};
+
+// Parse the move of an order n cube notated at text[i], seen with U on top & F in front, i is left after it.
+//  - faces U D R L F B, turned clockwise as seen looking at the face
+//  - a layer count in front turns that layer alone (2R, the second layer from R) or, with w, that many layers (3Rw)
+//  - w or a lower case face is a wide move, 2 layers unless counted
+//  - slices M (as L), E (as D) & S (as F), only on odd orders
+//  - rotations x (as R), y (as U) & z (as F)
+//  - then 2 for a half turn or ' for a counter-clockwise one (2' is a half turn too)
+// Returns false on anything else.
+inline bool parseNotatedMove(const std::string& text, size_t& i, int n, NotatedMove& move)
+{
+    // axis & the slice direction of a clockwise quarter turn, in the order of "UDRLFB"
+    static const char faces[] = "UDRLFB";
+    static const int faceAxis[6] = { AXIS_Y, AXIS_Y, AXIS_X, AXIS_X, AXIS_Z, AXIS_Z };
+    int layers = 0;
+    const size_t digits = i;
+    while (i < text.size() && std::isdigit((unsigned char)text[i]))
+    {
+        layers = layers * 10 + (text[i++] - '0');
+        // stop before the count can overflow, no count above n is valid anyway
+        if (layers > n)
+            return false;
+    }
+    const bool counted = i > digits;
+    // a count of 0 layers is as malformed as a missing move
+    if (i == text.size() || (counted && layers == 0))
+        return false;
+    const char letter = text[i++];
+    const char* face = std::strchr(faces, std::toupper((unsigned char)letter));
+    if (letter && face)
+    {
+        const int index = (int)(face - faces);
+        // U, R, F turn the top slice by -90 degree, D, L, B the bottom one by +90 degree
+        const bool top = index % 2 == 0;
+        bool wide = std::islower((unsigned char)letter) != 0;
+        if (i < text.size() && text[i] == 'w')
+        {
+            wide = true;
+            ++i;
+        }
+        if (wide && layers == 0)
+            layers = 2;
+        if (layers == 0)
+            layers = 1;
+        if (layers > n)
+            return false;
+        move.axis = faceAxis[index];
+        move.dir = top ? -1 : 1;
+        // counted layer alone, or every layer from the face inwards
+        const int depth = wide ? 0 : layers - 1;
+        move.first = top ? n - layers : depth;
+        move.last = top ? n - 1 - depth : layers - 1;
+    }
+    else if (counted)
+        return false;
+    else if (letter == 'M' || letter == 'E' || letter == 'S')
+    {
+        if (n % 2 == 0)
+            return false;
+        move.axis = letter == 'M' ? AXIS_X : letter == 'E' ? AXIS_Y : AXIS_Z;
+        move.dir = letter == 'S' ? -1 : 1;
+        move.first = move.last = n / 2;
+    }
+    else if (letter == 'x' || letter == 'y' || letter == 'z')
+    {
+        move.axis = letter == 'x' ? AXIS_X : letter == 'y' ? AXIS_Y : AXIS_Z;
+        move.dir = -1;
+        move.first = 0;
+        move.last = n - 1;
+    }
+    else
+        return false;
+
+    move.turns = 1;
+    if (i < text.size() && text[i] == '2')
+    {
+        move.turns = 2;
+        ++i;
+    }
+    if (i < text.size() && text[i] == '\'')
+    {
+        move.dir = -move.dir;
+        ++i;
+    }
+    return true;
+}
+
+// Parse the notation of an order n cube (see parseNotatedMove()) into slice moves. Moves may be separated by white
+// space or not at all. Returns false, with moves cleared, on anything else.
+inline bool parseCubeMoves(const std::string& text, int n, std::vector<CubeMove>& moves)
+{
+    moves.clear();
+    NotatedMove move;
+    for (size_t i = 0; i < text.size();)
+    {
+        if (std::isspace((unsigned char)text[i]))
+        {
+            ++i;
+            continue;
+        }
+        if (!parseNotatedMove(text, i, n, move))
+        {
+            moves.clear();
+            return false;
+        }
+        for (int t = 0; t < move.turns; ++t)
+            for (int s = move.first; s <= move.last; ++s)
+                moves.push_back(CubeMove(move.axis, s, move.dir));
+    }
+    return true;
+}
+
+// Parse 3x3x3 face moves (see faceMoveName()) in the same notation, any move of a single outer layer is one (R, L2,
+// 3R' as L). Returns false, with moves cleared, on anything else, e.g. slice & wide moves or rotations.
+inline bool parseFaceMoves(const std::string& text, std::vector<int>& moves)
+{
+    // face of the top (slice 2) & bottom (slice 0) layer of each axis
+    static const int topFace[3] = { SIDE_R, SIDE_U, SIDE_F };
+    static const int bottomFace[3] = { SIDE_L, SIDE_D, SIDE_B };
+    moves.clear();
+    NotatedMove move;
+    for (size_t i = 0; i < text.size();)
+    {
+        if (std::isspace((unsigned char)text[i]))
+        {
+            ++i;
+            continue;
+        }
+        if (!parseNotatedMove(text, i, 3, move) || move.first != move.last || move.first == 1)
+        {
+            moves.clear();
+            return false;
+        }
+        // a clockwise quarter turn is -90 degree on the top layer, +90 degree on the bottom one
+        const bool top = move.first == 2;
+        const bool clockwise = top ? move.dir < 0 : move.dir > 0;
+        const int power = move.turns == 2 ? 2 : clockwise ? 1 : 3;
+        moves.push_back((top ? topFace[move.axis] : bottomFace[move.axis]) * 3 + power - 1);
+    }
+    return true;
+}
+
+// the whole sequence as one permutation, see Cube<N>::applyPermutation(). permutation is reset first, so any
+// Cube<N> or DynamicCube of the right order will do
+template<class CubeType>
+void composeMoves(const CubeMove* moves, size_t count, CubeType& permutation)
+{
+    permutation.reset();
+    permutation.applyMoves(moves, count);
+}
+inline CubieCube composeFaceMoves(const std::vector<int>& moves)
+{
+    PackedCube permutation;
+    permutation.applyMoves(moves.data(), moves.size());
+    return permutation.toCubie();
+}
+
+// parse, simplify & compose in one go, false if the notation does not parse
+template<class CubeType>
+bool compileMoves(const std::string& text, std::vector<CubeMove>& moves, CubeType& permutation)
+{
+    if (!parseCubeMoves(text, permutation.order(), moves))
+        return false;
+    simplifyCubeMoves(moves, permutation.order());
+    composeMoves(moves.data(), moves.size(), permutation);
+    return true;
+}
+#endif
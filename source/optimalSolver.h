@@ -0,0 +1,449 @@
+#ifndef OPTIMAL_SOLVER_H
+#define OPTIMAL_SOLVER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cubeSymmetry.h"
+#include "cubieCube.h"
+#include "pruningTable.h"
+#include "transpositionTable.h"
+#include "zobristHash.h"
+
+// Optimal solver: IDA* over the cubie cube with Korf's pattern databases as heuristic.
+//
+// The corner database holds the exact distance of every corner state, reduced by the 16 symmetries that keep
+// the UD axis (2768 corner permutation classes * 3^7 twists instead of 8! * 3^7 entries), the two edge
+// databases that of the positions & flips of edges UR - DB and FR - BR respectively (12! / 6! * 2^6 entries
+// each). The maximum of the three never overestimates, so the first solution of the iteration that finds one
+// is optimal. The databases store distances modulo 3 (see Mod3PruningTable), so every node carries its exact
+// distance in each of them. Each iteration is split into its two-move prefixes which the worker threads take
+// one by one. The databases (about 23 MB) & move tables take a while to generate, so they are written to table
+// files & mapped on later starts. The first call to get() should still happen off the render thread.
+//
+// Every solve() of every thread shares one transposition table. A node with TRANSPOSITION_TOGO or more moves to go
+// that found no solution is stored with its moves to go & the face of the move that led to it, which restricts the
+// first move of its search. The entry says that no sequence of exactly that many moves, starting with those first
+// moves, solves the state. That holds whatever the scramble, so the state is skipped when it comes up again with as
+// many moves to go & no first move the earlier search left out, in the same iteration or in another solve().
+class OptimalSolver
+{
+public:
+    static const int TWIST_COUNT = 2187;
+    static const int PERM_COUNT = 40320;
+    static const int EDGE6_PERM_COUNT = 665280;    // 12 * 11 * 10 * 9 * 8 * 7
+    static const int EDGE6_COUNT = EDGE6_PERM_COUNT * 64;
+    static const int MAX_LENGTH = 20;
+    // moves to go from which nodes are worth a transposition table probe, below them the subtrees are too small
+    static const int TRANSPOSITION_TOGO = 6;
+    static const size_t TRANSPOSITION_MEGABYTES = 32;
+
+    struct Result
+    {
+        std::vector<int> moves;     // face moves, see faceMoveName()
+        bool found = false;
+        bool cancelled = false;
+        double seconds = 0.0;
+        uint64_t nodes = 0;
+        uint64_t cutoffs = 0;       // subtrees skipped by the transposition table
+    };
+
+    static const OptimalSolver& get()
+    {
+        static const OptimalSolver solver;
+        return solver;
+    }
+
+    // threads = 0 uses every core, setting *cancel from another thread makes solve() return without a solution
+    Result solve(const CubieCube& cube, int threads = 0, const std::atomic<bool>* cancel = nullptr) const
+    {
+        Result result;
+        const auto start = std::chrono::steady_clock::now();
+        if (threads <= 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        const Node root = nodeOf(cube);
+        // entries of earlier solves stay valid, they are just replaced first
+        transpositions.newGeneration();
+        for (int bound = heuristic(root); bound <= MAX_LENGTH && !result.found; ++bound)
+        {
+            Iteration iteration(*this, root, bound, cancel);
+            if (bound < 2)
+                iteration.work();
+            else
+            {
+                std::vector<std::thread> workers;
+                for (int i = 0; i < threads; ++i)
+                    workers.emplace_back(&Iteration::work, &iteration);
+                for (std::thread& worker : workers)
+                    worker.join();
+            }
+            result.nodes += iteration.nodes;
+            result.cutoffs += iteration.cutoffs;
+            if (iteration.found)
+            {
+                result.found = true;
+                result.moves = iteration.solution;
+            }
+            if (cancel && cancel->load(std::memory_order_relaxed))
+            {
+                result.cancelled = true;
+                break;
+            }
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    // the table every solve() shares, e.g. for its statistics
+    const TranspositionTable& transpositionTable() const
+    {
+        return transpositions;
+    }
+
+private:
+    // move tables, coordinate * FACE_MOVE_COUNT + move
+    TableArray<uint16_t> twistMove, cornerPermMove;
+    // edge6 move table, low 20 bits the new permutation, bits 20 - 25 flip the 6 edges
+    TableArray<uint32_t> edge6Move;
+    // twist of each symmetry conjugate, twist * SYM_UD_COUNT + sym
+    TableArray<uint16_t> twistConjugate;
+    SymCoordinate cornerPermSym;
+    Mod3PruningTable cornerTable, edgeTableLow, edgeTableHigh;
+    // edge6 permutation of the solved cube for edges 0 - 5 & 6 - 11
+    int solvedLow, solvedHigh;
+    // searched nodes: value the twist, payload the corner permutation & bits 16 - 18 the last face + 1, depth the
+    // moves to go
+    mutable TranspositionTable transpositions;
+
+    struct Node
+    {
+        uint16_t cornerPerm, twist;
+        uint32_t edgeLow, edgeHigh;     // permutation * 64 + flips
+        uint8_t cornerDistance, lowDistance, highDistance;
+    };
+
+    OptimalSolver() : transpositions(TRANSPOSITION_MEGABYTES)
+    {
+        // same files as the move tables of the two-phase solver
+        loadMoveTable(twistMove, "twist_move", TWIST_COUNT, &CubieCube::setTwist, &CubieCube::twist);
+        loadMoveTable(cornerPermMove, "corner_perm_move", PERM_COUNT, &CubieCube::setCornerPerm, &CubieCube::cornerPerm);
+        buildEdge6MoveTable();
+        CubieCube solved;
+        solvedLow = edge6Perm(solved, 0);
+        solvedHigh = edge6Perm(solved, 6);
+
+        loadTwistConjugateTable(twistConjugate);
+        loadCornerPermSymmetry(cornerPermSym);
+        buildCornerTable();
+        buildEdgeTable(edgeTableLow, "optimal_edge_low", solvedLow);
+        buildEdgeTable(edgeTableHigh, "optimal_edge_high", solvedHigh);
+    }
+
+    // positions of 6 edges (first..first + 5) as a partial permutation, 0 - 665279
+    static int edge6Perm(const CubieCube& cube, int first)
+    {
+        int position[6];
+        for (int i = 0; i < 12; ++i)
+            if (cube.ep[i] >= first && cube.ep[i] < first + 6)
+                position[cube.ep[i] - first] = i;
+        return encodeEdge6(position);
+    }
+    static int edge6Flip(const CubieCube& cube, int first)
+    {
+        int flip = 0;
+        for (int i = 0; i < 12; ++i)
+            if (cube.ep[i] >= first && cube.ep[i] < first + 6)
+                flip |= cube.eo[i] << (cube.ep[i] - first);
+        return flip;
+    }
+    // mixed radix, digit k counts the free positions below position k
+    static int encodeEdge6(const int position[6])
+    {
+        int index = 0, used = 0;
+        for (int k = 0; k < 6; ++k)
+        {
+            int below = 0;
+            for (int p = 0; p < position[k]; ++p)
+                below += !(used >> p & 1);
+            used |= 1 << position[k];
+            index = index * (12 - k) + below;
+        }
+        return index;
+    }
+    static void decodeEdge6(int index, int position[6])
+    {
+        int digit[6];
+        for (int k = 5; k >= 0; --k)
+        {
+            digit[k] = index % (12 - k);
+            index /= 12 - k;
+        }
+        int used = 0;
+        for (int k = 0; k < 6; ++k)
+        {
+            int p = 0;
+            for (int below = digit[k];; ++p)
+                if (!(used >> p & 1) && below-- == 0)
+                    break;
+            position[k] = p;
+            used |= 1 << p;
+        }
+    }
+
+    void buildEdge6MoveTable()
+    {
+        edge6Move.loadOrGenerate("optimal_edge6_move", (size_t)EDGE6_PERM_COUNT * FACE_MOVE_COUNT,
+                                 [](std::vector<uint32_t>& table)
+        {
+            // destination of the edge at each position under each move
+            int destination[FACE_MOVE_COUNT][12];
+            for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+                for (int i = 0; i < 12; ++i)
+                    destination[m][CubieCube::move(m).ep[i]] = i;
+            for (int index = 0; index < EDGE6_PERM_COUNT; ++index)
+            {
+                int position[6];
+                decodeEdge6(index, position);
+                for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+                {
+                    int moved[6];
+                    uint32_t flip = 0;
+                    for (int k = 0; k < 6; ++k)
+                    {
+                        moved[k] = destination[m][position[k]];
+                        flip |= (uint32_t)CubieCube::move(m).eo[moved[k]] << k;
+                    }
+                    table[(size_t)index * FACE_MOVE_COUNT + m] = (uint32_t)encodeEdge6(moved) | flip << 20;
+                }
+            }
+        });
+    }
+    // corner permutation class * TWIST_COUNT + conjugated twist, see TwoPhaseSolver::buildPhase1Table()
+    void buildCornerTable()
+    {
+        cornerTable.loadOrGenerate("optimal_corner_sym", (size_t)cornerPermSym.classCount() * TWIST_COUNT, [this](PruningTable& table)
+        {
+            const size_t solved = 0;
+            table.generate(&solved, 1, [this](size_t index, auto visit)
+            {
+                cornerNeighbours(index, visit);
+            });
+        });
+    }
+    template<class Visit>
+    void cornerNeighbours(size_t index, Visit visit) const
+    {
+        const int perm = (int)cornerPermSym.representative[index / TWIST_COUNT], twist = (int)(index % TWIST_COUNT);
+        for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+        {
+            const int next = cornerPermMove[perm * FACE_MOVE_COUNT + m];
+            const size_t cls = cornerPermSym.classOf(next);
+            const int nextTwist = twistConjugate[twistMove[twist * FACE_MOVE_COUNT + m] * SYM_UD_COUNT + cornerPermSym.symOf(next)];
+            if (visit(cls * TWIST_COUNT + nextTwist))
+                return;
+            const uint64_t self = cornerPermSym.selfSymmetry[cls];
+            for (int s = 1; self > 1 && s < SYM_UD_COUNT; ++s)
+                if ((self >> s & 1) && visit(cls * TWIST_COUNT + twistConjugate[nextTwist * SYM_UD_COUNT + s]))
+                    return;
+        }
+    }
+    void buildEdgeTable(Mod3PruningTable& table, const char* name, int solvedPerm)
+    {
+        table.loadOrGenerate(name, EDGE6_COUNT, [this, solvedPerm](PruningTable& table)
+        {
+            const size_t solved = (size_t)solvedPerm * 64;
+            table.generate(&solved, 1, [this](size_t index, auto visit)
+            {
+                edgeNeighbours(index, visit);
+            });
+        });
+    }
+    template<class Visit>
+    void edgeNeighbours(size_t index, Visit visit) const
+    {
+        for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+            if (visit(turnEdge6((uint32_t)index, m)))
+                return;
+    }
+
+    uint32_t turnEdge6(uint32_t edge, int m) const
+    {
+        uint32_t moved = edge6Move[(size_t)(edge >> 6) * FACE_MOVE_COUNT + m];
+        return (moved & 0xfffff) << 6 | ((edge & 63) ^ moved >> 20);
+    }
+    Node nodeOf(const CubieCube& cube) const
+    {
+        Node node;
+        node.cornerPerm = (uint16_t)cube.cornerPerm();
+        node.twist = (uint16_t)cube.twist();
+        node.edgeLow = (uint32_t)edge6Perm(cube, 0) << 6 | edge6Flip(cube, 0);
+        node.edgeHigh = (uint32_t)edge6Perm(cube, 6) << 6 | edge6Flip(cube, 6);
+        // the only place that needs exact distances from the tables, every other node derives them from its parent
+        auto corners = [this](size_t index, auto visit)
+        {
+            cornerNeighbours(index, visit);
+        };
+        auto edges = [this](size_t index, auto visit)
+        {
+            edgeNeighbours(index, visit);
+        };
+        node.cornerDistance = (uint8_t)cornerTable.exactDistance(cornerIndex(node), 0, corners);
+        node.lowDistance = (uint8_t)edgeTableLow.exactDistance(node.edgeLow, (size_t)solvedLow << 6, edges);
+        node.highDistance = (uint8_t)edgeTableHigh.exactDistance(node.edgeHigh, (size_t)solvedHigh << 6, edges);
+        return node;
+    }
+    // turn node into next, false as soon as one of the distances reaches limit (next is then only partly set)
+    bool turn(const Node& node, int m, int limit, Node& next) const
+    {
+        next.cornerPerm = cornerPermMove[node.cornerPerm * FACE_MOVE_COUNT + m];
+        next.twist = twistMove[node.twist * FACE_MOVE_COUNT + m];
+        next.cornerDistance = (uint8_t)Mod3PruningTable::distance(node.cornerDistance, cornerTable.get(cornerIndex(next)));
+        if (next.cornerDistance >= limit)
+            return false;
+        next.edgeLow = turnEdge6(node.edgeLow, m);
+        next.lowDistance = (uint8_t)Mod3PruningTable::distance(node.lowDistance, edgeTableLow.get(next.edgeLow));
+        if (next.lowDistance >= limit)
+            return false;
+        next.edgeHigh = turnEdge6(node.edgeHigh, m);
+        next.highDistance = (uint8_t)Mod3PruningTable::distance(node.highDistance, edgeTableHigh.get(next.edgeHigh));
+        return next.highDistance < limit;
+    }
+    size_t cornerIndex(const Node& node) const
+    {
+        const uint32_t classSym = cornerPermSym.classSym[node.cornerPerm];
+        return (size_t)(classSym >> 8) * TWIST_COUNT + twistConjugate[node.twist * SYM_UD_COUNT + (classSym & 0xff)];
+    }
+    int heuristic(const Node& node) const
+    {
+        return std::max(node.cornerDistance, std::max(node.lowDistance, node.highDistance));
+    }
+    bool isSolved(const Node& node) const
+    {
+        return node.cornerPerm == 0 && node.twist == 0 && node.edgeLow == (uint32_t)solvedLow << 6 && node.edgeHigh == (uint32_t)solvedHigh << 6;
+    }
+    // a face is never turned twice in a row & of two opposite faces only the order U D, R L, F B is searched
+    static bool skipFace(int face, int lastFace)
+    {
+        return lastFace >= 0 && (face == lastFace || face == lastFace - 3);
+    }
+
+    // the two edge coordinates take 52 bits, the corner ones 28
+    static uint64_t hashOf(const Node& node)
+    {
+        const uint64_t edges = (uint64_t)node.edgeLow << 26 | node.edgeHigh;
+        return ZobristHash::mix(ZobristHash::mix(edges) + ((uint64_t)node.cornerPerm << 12 | node.twist));
+    }
+    // node was searched before with togo moves to go & at least the first moves lastFace leaves
+    bool searched(uint64_t hash, const Node& node, int togo, int lastFace) const
+    {
+        TranspositionTable::Entry entry;
+        if (!transpositions.probe(hash, entry) || entry.depth != togo || entry.value != node.twist
+            || (entry.payload & 0xffff) != node.cornerPerm)
+            return false;
+        // skipFace() of the earlier search left out no face this one searches
+        const int earlierFace = (int)(entry.payload >> 16) - 1;
+        return earlierFace < 0 || earlierFace == lastFace || (lastFace >= 3 && earlierFace == lastFace - 3);
+    }
+    void storeSearched(uint64_t hash, const Node& node, int togo, int lastFace) const
+    {
+        const uint32_t payload = node.cornerPerm | (uint32_t)(lastFace + 1) << 16;
+        transpositions.store(hash, TranspositionTable::Entry{ node.twist, (uint8_t)togo, payload });
+    }
+
+    // one depth bound of IDA*, shared by the worker threads
+    struct Iteration
+    {
+        const OptimalSolver& solver;
+        const Node root;
+        const int bound;
+        const std::atomic<bool>* cancel;
+        std::vector<int> prefixes;          // first * FACE_MOVE_COUNT + second
+        std::atomic<size_t> nextPrefix;
+        std::atomic<bool> found;
+        std::atomic<uint64_t> nodes;
+        std::atomic<uint64_t> cutoffs;
+        std::mutex solutionLock;
+        std::vector<int> solution;
+
+        Iteration(const OptimalSolver& solver, const Node& root, int bound, const std::atomic<bool>* cancel)
+            : solver(solver), root(root), bound(bound), cancel(cancel), nextPrefix(0), found(false), nodes(0), cutoffs(0)
+        {
+            for (int first = 0; first < FACE_MOVE_COUNT; ++first)
+                for (int second = 0; second < FACE_MOVE_COUNT; ++second)
+                    if (!skipFace(second / 3, first / 3))
+                        prefixes.push_back(first * FACE_MOVE_COUNT + second);
+        }
+
+        bool stopped() const
+        {
+            return found.load(std::memory_order_relaxed) || (cancel && cancel->load(std::memory_order_relaxed));
+        }
+
+        void work()
+        {
+            int path[MAX_LENGTH];
+            uint64_t count = 0;
+            if (bound < 2)
+                search(root, 0, bound, -1, path, count);
+            else
+                for (size_t i; !stopped() && (i = nextPrefix.fetch_add(1)) < prefixes.size();)
+                {
+                    path[0] = prefixes[i] / FACE_MOVE_COUNT;
+                    path[1] = prefixes[i] % FACE_MOVE_COUNT;
+                    Node first, second;
+                    count += 2;
+                    if (!solver.turn(root, path[0], bound, first) || !solver.turn(first, path[1], bound - 1, second))
+                        continue;
+                    search(second, 2, bound - 2, path[1] / 3, path, count);
+                }
+            nodes += count;
+        }
+
+        bool search(const Node& node, int depth, int togo, int lastFace, int* path, uint64_t& count)
+        {
+            ++count;
+            if (togo == 0)
+            {
+                if (!solver.isSolved(node))
+                    return false;
+                std::lock_guard<std::mutex> lock(solutionLock);
+                if (!found)
+                {
+                    solution.assign(path, path + depth);
+                    found = true;
+                }
+                return true;
+            }
+            if ((count & 0x3ff) == 0 && stopped())
+                return false;
+            const bool tabled = togo >= TRANSPOSITION_TOGO;
+            const uint64_t hash = tabled ? hashOf(node) : 0;
+            if (tabled && solver.searched(hash, node, togo, lastFace))
+            {
+                cutoffs.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+            {
+                if (skipFace(m / 3, lastFace))
+                    continue;
+                Node next;
+                if (!solver.turn(node, m, togo, next))
+                    continue;
+                path[depth] = m;
+                if (search(next, depth + 1, togo - 1, m / 3, path, count))
+                    return true;
+            }
+            // a search cut short by a solution elsewhere or cancel proves nothing
+            if (tabled && !stopped())
+                solver.storeSearched(hash, node, togo, lastFace);
+            return false;
+        }
+    };
+};
+#endif
@@ -0,0 +1,316 @@
+#ifndef PACKED_CUBE_H
+#define PACKED_CUBE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "cubieCube.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PACKED_CUBE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC takes every intrinsic without target flags
+#define PACKED_CUBE_TARGET(isa)
+#else
+#define PACKED_CUBE_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+// CubieCube packed into 32 bytes: corner positions in bytes 0 - 7, edge positions in bytes 16 - 27, each byte the
+// cubie (low 4 bits) plus its orientation * 16. Every unused byte holds its own index within its 16-byte half.
+//
+// With corners & edges in separate 16-byte halves, a * b is one byte shuffle of a by the cubie bits of b (pshufb
+// only reads the low 4 bits of each index byte), the orientation bits of b added, then x = min(x, x - 3 * 16) on
+// the corners & min(x, x - 2 * 16) on the edges. That is the orientation modulo 3 or 2, since x - modulus wraps
+// around to above x whenever the orientation is already in range. The unused bytes map onto themselves, so
+// the whole state goes through one 256-bit vpshufb (AVX2), two 128-bit pshufb (SSSE3) or a byte loop.
+// The kernel is picked once at runtime from what the CPU supports. Reflections (twists 3 - 5, see cubeSymmetry.h)
+// are not representable.
+class alignas(32) PackedCube
+{
+public:
+    enum Kernel
+    {
+        KERNEL_SCALAR,
+        KERNEL_SSSE3,
+        KERNEL_AVX2
+    };
+
+    uint8_t bytes[32];
+
+    // constructor gives the solved cube
+    PackedCube()
+    {
+        for (int i = 0; i < 32; ++i)
+            bytes[i] = (uint8_t)(i & 15);
+    }
+    explicit PackedCube(const CubieCube& cube) : PackedCube()
+    {
+        for (int i = 0; i < 8; ++i)
+            bytes[i] = (uint8_t)(cube.cp[i] | cube.co[i] << 4);
+        for (int i = 0; i < 12; ++i)
+            bytes[16 + i] = (uint8_t)(cube.ep[i] | cube.eo[i] << 4);
+    }
+    CubieCube toCubie() const
+    {
+        CubieCube cube;
+        for (int i = 0; i < 8; ++i)
+        {
+            cube.cp[i] = bytes[i] & 15;
+            cube.co[i] = bytes[i] >> 4;
+        }
+        for (int i = 0; i < 12; ++i)
+        {
+            cube.ep[i] = bytes[16 + i] & 15;
+            cube.eo[i] = bytes[16 + i] >> 4;
+        }
+        return cube;
+    }
+
+    // kernel multiply() & applyMoves() run, the best one of this CPU, picked once & never changed so any thread may
+    // read it. A different kernel is passed to applyMoves() explicitly (e.g. to compare them)
+    static Kernel kernel()
+    {
+        static const Kernel selected = detectKernel();
+        return selected;
+    }
+    static Kernel detectKernel()
+    {
+#ifdef PACKED_CUBE_X86
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        const int leaves = info[0];
+        __cpuid(info, 1);
+        const bool ssse3 = (info[2] >> 9 & 1) != 0;
+        // AVX2 also needs the OS to save the ymm registers (OSXSAVE & XCR0 bits 1, 2)
+        const bool osAvx = (info[2] >> 27 & 1) != 0 && (_xgetbv(0) & 6) == 6;
+        bool avx2 = false;
+        if (leaves >= 7 && osAvx)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] >> 5 & 1) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        const bool ssse3 = __builtin_cpu_supports("ssse3");
+        const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+        if (avx2)
+            return KERNEL_AVX2;
+        if (ssse3)
+            return KERNEL_SSSE3;
+#endif
+        return KERNEL_SCALAR;
+    }
+
+    // the cube after face move m of the solved cube
+    static const PackedCube& move(int m)
+    {
+        static const struct Moves
+        {
+            PackedCube cube[FACE_MOVE_COUNT];
+            Moves()
+            {
+                for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+                    cube[m] = PackedCube(CubieCube::move(m));
+            }
+        } table;
+        return table.cube[m];
+    }
+
+    // this = this * other, i.e. apply other after this
+    void multiply(const PackedCube& other)
+    {
+        applyMoves(&other, 1);
+    }
+    void applyMove(int m)
+    {
+        multiply(move(m));
+    }
+    // apply the face moves one after another, the state stays in registers in between
+    void applyMoves(const int* moves, size_t count)
+    {
+        applyMoves(kernel(), moves, count);
+    }
+    void applyMoves(const PackedCube* others, size_t count)
+    {
+        applyMoves(kernel(), others, count);
+    }
+    // the same with the given kernel, one this CPU supports (at most detectKernel())
+    void applyMoves(Kernel selected, const int* moves, size_t count)
+    {
+        switch (selected)
+        {
+#ifdef PACKED_CUBE_X86
+        case KERNEL_AVX2:
+            applyAvx2(*this, moves, count);
+            return;
+        case KERNEL_SSSE3:
+            applySsse3(*this, moves, count);
+            return;
+#endif
+        default:
+            applyScalar(*this, moves, count);
+        }
+    }
+    void applyMoves(Kernel selected, const PackedCube* others, size_t count)
+    {
+        switch (selected)
+        {
+#ifdef PACKED_CUBE_X86
+        case KERNEL_AVX2:
+            applyAvx2(*this, others, count);
+            return;
+        case KERNEL_SSSE3:
+            applySsse3(*this, others, count);
+            return;
+#endif
+        default:
+            applyScalar(*this, others, count);
+        }
+    }
+
+    bool operator==(const PackedCube& other) const
+    {
+        return std::memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+    }
+    bool operator!=(const PackedCube& other) const
+    {
+        return !(*this == other);
+    }
+
+    // coordinates, see CubieCube
+    // --------------------------
+    int twist() const
+    {
+        int result = 0;
+        for (int i = 0; i < 7; ++i)
+            result = result * 3 + (bytes[i] >> 4);
+        return result;
+    }
+    int flip() const
+    {
+        int result = 0;
+        for (int i = 0; i < 11; ++i)
+            result = result * 2 + (bytes[16 + i] >> 4);
+        return result;
+    }
+    int sliceSorted() const
+    {
+        return toCubie().sliceSorted();
+    }
+    int cornerPerm() const
+    {
+        return toCubie().cornerPerm();
+    }
+    int udEdgePerm() const
+    {
+        return toCubie().udEdgePerm();
+    }
+    void setTwist(int twist)
+    {
+        set(&CubieCube::setTwist, twist);
+    }
+    void setFlip(int flip)
+    {
+        set(&CubieCube::setFlip, flip);
+    }
+    void setSliceSorted(int index)
+    {
+        set(&CubieCube::setSliceSorted, index);
+    }
+    void setCornerPerm(int index)
+    {
+        set(&CubieCube::setCornerPerm, index);
+    }
+    void setUdEdgePerm(int index)
+    {
+        set(&CubieCube::setUdEdgePerm, index);
+    }
+
+private:
+    void set(void (CubieCube::*setter)(int), int value)
+    {
+        CubieCube cube = toCubie();
+        (cube.*setter)(value);
+        *this = PackedCube(cube);
+    }
+
+    static const PackedCube& factor(const int* moves, size_t i)
+    {
+        return move(moves[i]);
+    }
+    static const PackedCube& factor(const PackedCube* others, size_t i)
+    {
+        return others[i];
+    }
+
+    template<class Factors>
+    static void applyScalar(PackedCube& cube, const Factors* factors, size_t count)
+    {
+        for (size_t k = 0; k < count; ++k)
+        {
+            // the unused bytes never change, only the 20 cubies are worth a loop
+            const uint8_t* other = factor(factors, k).bytes;
+            PackedCube product = cube;
+            for (int i = 0; i < 8; ++i)
+            {
+                const int x = cube.bytes[other[i] & 15] + (other[i] & 0x30);
+                product.bytes[i] = (uint8_t)(x >= 0x30 ? x - 0x30 : x);
+            }
+            for (int i = 16; i < 28; ++i)
+            {
+                const int x = cube.bytes[16 + (other[i] & 15)] + (other[i] & 0x30);
+                product.bytes[i] = (uint8_t)(x >= 0x20 ? x - 0x20 : x);
+            }
+            cube = product;
+        }
+    }
+
+#ifdef PACKED_CUBE_X86
+    template<class Factors>
+    PACKED_CUBE_TARGET("ssse3")
+    static void applySsse3(PackedCube& cube, const Factors* factors, size_t count)
+    {
+        const __m128i orientation = _mm_set1_epi8(0x30);
+        const __m128i cornerModulus = _mm_set1_epi8(0x30), edgeModulus = _mm_set1_epi8(0x20);
+        __m128i corners = _mm_load_si128((const __m128i*)cube.bytes);
+        __m128i edges = _mm_load_si128((const __m128i*)(cube.bytes + 16));
+        for (size_t k = 0; k < count; ++k)
+        {
+            const uint8_t* other = factor(factors, k).bytes;
+            const __m128i otherCorners = _mm_load_si128((const __m128i*)other);
+            const __m128i otherEdges = _mm_load_si128((const __m128i*)(other + 16));
+            corners = _mm_add_epi8(_mm_shuffle_epi8(corners, otherCorners), _mm_and_si128(otherCorners, orientation));
+            corners = _mm_min_epu8(corners, _mm_sub_epi8(corners, cornerModulus));
+            edges = _mm_add_epi8(_mm_shuffle_epi8(edges, otherEdges), _mm_and_si128(otherEdges, orientation));
+            edges = _mm_min_epu8(edges, _mm_sub_epi8(edges, edgeModulus));
+        }
+        _mm_store_si128((__m128i*)cube.bytes, corners);
+        _mm_store_si128((__m128i*)(cube.bytes + 16), edges);
+    }
+
+    template<class Factors>
+    PACKED_CUBE_TARGET("avx2")
+    static void applyAvx2(PackedCube& cube, const Factors* factors, size_t count)
+    {
+        const __m256i orientation = _mm256_set1_epi8(0x30);
+        // vpshufb works within each 128-bit half, exactly the corner & edge halves
+        const __m256i modulus = _mm256_setr_epi8(0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30,
+                                                 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20);
+        __m256i state = _mm256_load_si256((const __m256i*)cube.bytes);
+        for (size_t k = 0; k < count; ++k)
+        {
+            const __m256i other = _mm256_load_si256((const __m256i*)factor(factors, k).bytes);
+            state = _mm256_add_epi8(_mm256_shuffle_epi8(state, other), _mm256_and_si256(other, orientation));
+            state = _mm256_min_epu8(state, _mm256_sub_epi8(state, modulus));
+        }
+        _mm256_store_si256((__m256i*)cube.bytes, state);
+    }
+#endif
+};
+#endif
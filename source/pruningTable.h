@@ -0,0 +1,343 @@
+#ifndef PRUNING_TABLE_H
+#define PRUNING_TABLE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tableFile.h"
+
+// Distance to solved of every state of a coordinate space, used as admissible heuristic by the solvers.
+// Entries take 4 bits, 16 per 64-bit word (little endian, so entry i is in the low or high half of byte i / 2),
+// so no table may hold a depth above 14 (15 marks an unvisited entry).
+// A table either owns its entries or reads them straight from a memory-mapped table file.
+class PruningTable
+{
+public:
+    static const int EMPTY = 0xf;
+    // entries one generator thread takes at a time, a multiple of the 16 entries of a word
+    static const size_t CHUNK = 1 << 14;
+
+    explicit PruningTable(size_t size = 0)
+    {
+        resize(size);
+    }
+    PruningTable(const PruningTable&) = delete;
+    PruningTable& operator=(const PruningTable&) = delete;
+
+    // threads generate() runs on, 0 uses every core
+    static int& generatorThreads()
+    {
+        static int threads = 0;
+        return threads;
+    }
+
+    void resize(size_t size)
+    {
+        file.reset();
+        entries = size;
+        wordCount = (size + 15) / 16;
+        words.reset(new std::atomic<uint64_t>[wordCount]);
+        for (size_t i = 0; i < wordCount; ++i)
+            words[i].store(~0ull, std::memory_order_relaxed);
+        bytes = reinterpret_cast<const uint8_t*>(words.get());
+    }
+    size_t size() const
+    {
+        return entries;
+    }
+    size_t byteSize() const
+    {
+        return (entries + 1) / 2;
+    }
+    bool mapped() const
+    {
+        return file != nullptr;
+    }
+
+    int get(size_t index) const
+    {
+        return bytes[index >> 1] >> ((index & 1) * 4) & 0xf;
+    }
+    // only for tables that own their entries
+    void set(size_t index, int depth)
+    {
+        std::atomic<uint64_t>& word = words[index >> 4];
+        const int shift = (int)(index & 15) * 4;
+        word.store((word.load(std::memory_order_relaxed) & ~(0xfull << shift)) | (uint64_t)depth << shift, std::memory_order_relaxed);
+    }
+
+    // Breadth first search from the solved entries, one pass over the table per depth.
+    // neighbours(index, visit) must call visit(next) for every state one move away from index & may stop as soon as
+    // visit returns true, it is called from several threads at once. Every pass expands exactly the entries of one
+    // depth & an entry only ever goes from EMPTY to depth + 1 (by compare-and-swap of its word), so the table comes
+    // out the same for any thread count.
+    // Once fewer entries are left EMPTY than the last pass found, a pass goes backwards instead: every EMPTY entry
+    // looks for a neighbour of the current depth, which mostly finds one after a few moves. That needs the move
+    // set to be closed under inverses, true for every table here.
+    template<class Neighbours>
+    void generate(const size_t* roots, size_t rootCount, Neighbours neighbours)
+    {
+        resize(entries);
+        for (size_t i = 0; i < rootCount; ++i)
+            set(roots[i], 0);
+        size_t filled = rootCount, previous = rootCount;
+        const int threads = generatorThreads() > 0 ? generatorThreads() : std::max(1, (int)std::thread::hardware_concurrency());
+        const auto start = std::chrono::steady_clock::now();
+        for (int depth = 0; filled < entries && depth + 1 < EMPTY; ++depth)
+        {
+            const bool backward = entries - filled < previous;
+            std::atomic<size_t> nextChunk(0), found(0);
+            auto expand = [&]()
+            {
+                size_t claimed = 0;
+                for (size_t chunk; (chunk = nextChunk.fetch_add(1)) * CHUNK < entries;)
+                {
+                    const size_t end = std::min(entries, (chunk + 1) * CHUNK);
+                    for (size_t first = chunk * CHUNK; first < end; first += 16)
+                    {
+                        const uint64_t word = words[first >> 4].load(std::memory_order_relaxed);
+                        for (size_t index = first; index < std::min(end, first + 16); ++index)
+                        {
+                            const int entry = (int)(word >> (index & 15) * 4 & 0xf);
+                            if (backward && entry == EMPTY)
+                            {
+                                bool reached = false;
+                                neighbours(index, [this, depth, &reached](size_t next)
+                                {
+                                    return reached = get(next) == depth;
+                                });
+                                if (reached)
+                                    claimed += claim(index, depth + 1);
+                            }
+                            else if (!backward && entry == depth)
+                                neighbours(index, [this, depth, &claimed](size_t next)
+                                {
+                                    claimed += claim(next, depth + 1);
+                                    return false;
+                                });
+                        }
+                    }
+                }
+                found += claimed;
+            };
+            std::vector<std::thread> workers;
+            for (int i = 1; i < threads; ++i)
+                workers.emplace_back(expand);
+            expand();
+            for (std::thread& worker : workers)
+                worker.join();
+            filled += found;
+            previous = found;
+            if (reportName)
+                std::clog << "INFO::PRUNING_TABLE::GENERATE <" << reportName << "> <depth " << depth + 1 << (backward ? " backward" : "")
+                          << ": " << filled << " / " << entries << ", "
+                          << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s>" << std::endl;
+            if (found == 0)
+                break;
+        }
+    }
+
+    // map <tableDirectory()>/<name>.prun if it holds a table of this size
+    bool load(const char* name, size_t size, bool verify = false)
+    {
+        std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+        const uint8_t* payload = openTableFile(*mapping, path(name), name, size, (size + 1) / 2, verify);
+        if (!payload)
+            return false;
+        words.reset();
+        entries = size;
+        wordCount = 0;
+        bytes = payload;
+        file = mapping;
+        return true;
+    }
+    bool save(const char* name) const
+    {
+        return writeTableFile(path(name), name, entries, bytes, byteSize());
+    }
+
+    // map the table file, or generate the table with generate(table) & write the file for the next start
+    template<class Generate>
+    void loadOrGenerate(const char* name, size_t size, Generate generate)
+    {
+        if (load(name, size))
+            return;
+        generateLogged(name, size, generate);
+        if (!save(name))
+            std::cerr << "WARNING::PRUNING_TABLE::SAVE_FAILED <" << path(name) << ">" << std::endl;
+        // map the file just written with its checksum verified, the generated table stays in use if it does not check out
+        else if (!load(name, size, true))
+            std::cerr << "WARNING::PRUNING_TABLE::VERIFY_FAILED <" << path(name) << ">" << std::endl;
+    }
+
+    // resize & generate(table), the progress of generate() is logged under name
+    template<class Generate>
+    void generateLogged(const char* name, size_t size, Generate generate)
+    {
+        resize(size);
+        reportName = name;
+        generate(*this);
+        reportName = nullptr;
+    }
+
+private:
+    size_t entries;
+    size_t wordCount;
+    std::unique_ptr<std::atomic<uint64_t>[]> words;
+    const uint8_t* bytes;
+    std::shared_ptr<MappedFile> file;
+    // table being generated by loadOrGenerate(), its progress is logged
+    const char* reportName = nullptr;
+
+    // set an EMPTY entry to depth, false if it was already set (by this or another thread)
+    bool claim(size_t index, int depth)
+    {
+        std::atomic<uint64_t>& word = words[index >> 4];
+        const int shift = (int)(index & 15) * 4;
+        uint64_t old = word.load(std::memory_order_relaxed);
+        do
+        {
+            if ((int)(old >> shift & 0xf) != EMPTY)
+                return false;
+        } while (!word.compare_exchange_weak(old, (old & ~(0xfull << shift)) | (uint64_t)depth << shift, std::memory_order_relaxed));
+        return true;
+    }
+
+    static std::string path(const char* name)
+    {
+        return tableDirectory() + "/" + name + ".prun";
+    }
+};
+
+// Pruning table holding every distance modulo 3 in 2 bits, 4 entries per byte (3 marks an unvisited entry), half
+// the size of a PruningTable. The distances of neighbouring states differ by at most one, so a search that knows
+// the exact distance of a state gets that of each neighbour from its residue (distance()). The exact distance of
+// the root of a search comes from walking down to the solved entry (exactDistance()).
+class Mod3PruningTable
+{
+public:
+    // residue of an entry the generation never reached
+    static const int UNVISITED = 3;
+    // distance of a state that cannot reach the root (an UNVISITED entry), larger than any search goes
+    static const int UNREACHABLE = 0xff;
+
+    size_t size() const
+    {
+        return entries;
+    }
+    size_t byteSize() const
+    {
+        return (entries + 3) / 4;
+    }
+
+    int get(size_t index) const
+    {
+        return bytes[index >> 2] >> ((index & 3) * 2) & 3;
+    }
+    // exact distance of a neighbour with residue get(next) of a state at distance parent
+    static int distance(int parent, int residue)
+    {
+        if (residue == UNVISITED)
+            return UNREACHABLE;
+        // residue - parent % 3 + 3 is 3 for the same distance, 1 or 4 for one more & 2 or 5 for one less
+        static constexpr int8_t step[6] = { 0, 1, -1, 0, 1, -1 };
+        return parent + step[residue - parent % 3 + 3];
+    }
+    // exact distance of index, neighbours(index, visit) as for PruningTable::generate(). UNREACHABLE if the walk
+    // gets stuck on an entry without a closer neighbour (an unvisited or corrupt entry, or a root of another table)
+    template<class Neighbours>
+    int exactDistance(size_t index, size_t root, Neighbours neighbours) const
+    {
+        int depth = 0;
+        for (; index != root; ++depth)
+        {
+            // a corrupt table may also lead around in circles
+            if (get(index) == UNVISITED || depth == UNREACHABLE)
+                return UNREACHABLE;
+            // one neighbour is a move closer to root, its residue is one less
+            const int closer = (get(index) + 2) % 3;
+            size_t next = index;
+            neighbours(index, [this, closer, &next](size_t neighbour)
+            {
+                if (get(neighbour) != closer)
+                    return false;
+                next = neighbour;
+                return true;
+            });
+            if (next == index)
+                return UNREACHABLE;
+            index = next;
+        }
+        return depth;
+    }
+
+    // residues of a fully generated table
+    void pack(const PruningTable& table)
+    {
+        file.reset();
+        entries = table.size();
+        owned.assign(byteSize(), 0xff);
+        for (size_t i = 0; i < entries; ++i)
+        {
+            const int depth = table.get(i);
+            const int residue = depth == PruningTable::EMPTY ? UNVISITED : depth % 3;
+            owned[i >> 2] = (uint8_t)((owned[i >> 2] & ~(3 << (i & 3) * 2)) | residue << (i & 3) * 2);
+        }
+        bytes = owned.data();
+    }
+
+    bool load(const char* name, size_t size, bool verify = false)
+    {
+        std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+        const uint8_t* payload = openTableFile(*mapping, path(name), name, size, (size + 3) / 4, verify);
+        if (!payload)
+            return false;
+        owned.clear();
+        entries = size;
+        bytes = payload;
+        file = mapping;
+        return true;
+    }
+    bool save(const char* name) const
+    {
+        return writeTableFile(path(name), name, entries, bytes, byteSize());
+    }
+
+    // map the table file, or generate(table) an exact PruningTable, pack it & write the file for the next start
+    template<class Generate>
+    void loadOrGenerate(const char* name, size_t size, Generate generate)
+    {
+        if (load(name, size))
+            return;
+        {
+            PruningTable exact;
+            exact.generateLogged(name, size, generate);
+            pack(exact);
+        }
+        if (!save(name))
+            std::cerr << "WARNING::PRUNING_TABLE::SAVE_FAILED <" << path(name) << ">" << std::endl;
+        // map the file just written with its checksum verified, the generated table stays in use if it does not check out
+        else if (!load(name, size, true))
+            std::cerr << "WARNING::PRUNING_TABLE::VERIFY_FAILED <" << path(name) << ">" << std::endl;
+    }
+
+private:
+    size_t entries = 0;
+    std::vector<uint8_t> owned;
+    const uint8_t* bytes = nullptr;
+    std::shared_ptr<MappedFile> file;
+
+    static std::string path(const char* name)
+    {
+        return tableDirectory() + "/" + name + ".mod3";
+    }
+};
+#endif
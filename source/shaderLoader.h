@@ -3,7 +3,11 @@
 
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -11,6 +15,12 @@
 class Shader
 {
 public:
+    // pre-resolved uniform handle, fetch it once with getUniform() and reuse it in the render loop
+    struct Uniform
+    {
+        GLint location = -1;
+    };
+
     bool valid;
     GLuint ID;
     // constructor generates the shader on the fly
@@ -110,6 +120,50 @@ public:
         std::clog << "INFO::SHADER::DELETE_SHADER <" << "FRAGMENT" << ">" << std::endl;
 #endif
         glDeleteShader(fragment);
+        // 3. introspect the active uniforms once, so no glGetUniformLocation is needed per frame
+        if (valid)
+        {
+            cacheUniforms();
+        }
+    }
+    // FNV-1a hash of a uniform name, usable at compile time
+    // ------------------------------------------------------------------------
+    static constexpr uint32_t hashName(const char* name)
+    {
+        uint32_t hash = 2166136261u;
+        while (*name)
+        {
+            hash = (hash ^ (uint8_t)*name++) * 16777619u;
+        }
+        return hash;
+    }
+    // look up a uniform in the cache, an unknown name gives location -1 which glUniform* ignores
+    // ------------------------------------------------------------------------
+    GLint getLocation(const char* name) const
+    {
+        uint32_t hash = hashName(name);
+        auto it = std::lower_bound(uniformTable.begin(), uniformTable.end(), hash,
+            [](const UniformEntry& entry, uint32_t value) { return entry.hash < value; });
+        for (; it != uniformTable.end() && it->hash == hash; ++it)
+        {
+            if (strcmp(it->name.c_str(), name) == 0)
+                return it->location;
+        }
+        return -1;
+    }
+    Uniform getUniform(const char* name) const
+    {
+        Uniform uniform;
+        uniform.location = getLocation(name);
+        return uniform;
+    }
+    // connect a uniform block of the program to a uniform buffer binding point
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const char* name, GLuint binding) const
+    {
+        GLuint blockIndex = glGetUniformBlockIndex(ID, name);
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, blockIndex, binding);
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -119,64 +173,203 @@ public:
     }
     // utility uniform functions
 // ------------------------------------------------------------------------
+    void setBool(Uniform uniform, bool value) const
+    {
+        glUniform1i(uniform.location, (int)value);
+    }
+    void setBool(const char* name, bool value) const
+    {
+        setBool(getUniform(name), value);
+    }
     void setBool(const std::string& name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        setBool(name.c_str(), value);
     }
     // ------------------------------------------------------------------------
+    void setInt(Uniform uniform, int value) const
+    {
+        glUniform1i(uniform.location, value);
+    }
+    void setInt(const char* name, int value) const
+    {
+        setInt(getUniform(name), value);
+    }
     void setInt(const std::string& name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        setInt(name.c_str(), value);
     }
     // ------------------------------------------------------------------------
+    void setFloat(Uniform uniform, float value) const
+    {
+        glUniform1f(uniform.location, value);
+    }
+    void setFloat(const char* name, float value) const
+    {
+        setFloat(getUniform(name), value);
+    }
     void setFloat(const std::string& name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        setFloat(name.c_str(), value);
+    }
+    void setFloatArray(Uniform uniform, const float* values, int count) const
+    {
+        glUniform1fv(uniform.location, count, values);
     }
     // ------------------------------------------------------------------------
+    void setVec2(Uniform uniform, const glm::vec2& value) const
+    {
+        glUniform2fv(uniform.location, 1, &value[0]);
+    }
+    void setVec2(const char* name, const glm::vec2& value) const
+    {
+        setVec2(getUniform(name), value);
+    }
     void setVec2(const std::string& name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec2(name.c_str(), value);
+    }
+    void setVec2(const char* name, float x, float y) const
+    {
+        glUniform2f(getLocation(name), x, y);
     }
     void setVec2(const std::string& name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        setVec2(name.c_str(), x, y);
     }
     // ------------------------------------------------------------------------
+    void setVec3(Uniform uniform, const glm::vec3& value) const
+    {
+        glUniform3fv(uniform.location, 1, &value[0]);
+    }
+    void setVec3(const char* name, const glm::vec3& value) const
+    {
+        setVec3(getUniform(name), value);
+    }
     void setVec3(const std::string& name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec3(name.c_str(), value);
+    }
+    void setVec3(const char* name, float x, float y, float z) const
+    {
+        glUniform3f(getLocation(name), x, y, z);
     }
     void setVec3(const std::string& name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        setVec3(name.c_str(), x, y, z);
     }
     // ------------------------------------------------------------------------
+    void setVec4(Uniform uniform, const glm::vec4& value) const
+    {
+        glUniform4fv(uniform.location, 1, &value[0]);
+    }
+    void setVec4(const char* name, const glm::vec4& value) const
+    {
+        setVec4(getUniform(name), value);
+    }
     void setVec4(const std::string& name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec4(name.c_str(), value);
+    }
+    void setVec4(const char* name, float x, float y, float z, float w) const
+    {
+        glUniform4f(getLocation(name), x, y, z, w);
     }
-    void setVec4(const std::string& name, float x, float y, float z, float w)
+    void setVec4(const std::string& name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        setVec4(name.c_str(), x, y, z, w);
     }
     // ------------------------------------------------------------------------
+    void setMat2(Uniform uniform, const glm::mat2& mat) const
+    {
+        glUniformMatrix2fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat2(const char* name, const glm::mat2& mat) const
+    {
+        setMat2(getUniform(name), mat);
+    }
     void setMat2(const std::string& name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat2(name.c_str(), mat);
     }
     // ------------------------------------------------------------------------
+    void setMat3(Uniform uniform, const glm::mat3& mat) const
+    {
+        glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat3(const char* name, const glm::mat3& mat) const
+    {
+        setMat3(getUniform(name), mat);
+    }
     void setMat3(const std::string& name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat3(name.c_str(), mat);
     }
     // ------------------------------------------------------------------------
+    void setMat4(Uniform uniform, const glm::mat4& mat) const
+    {
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(const char* name, const glm::mat4& mat) const
+    {
+        setMat4(getUniform(name), mat);
+    }
     void setMat4(const std::string& name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat4(name.c_str(), mat);
     }
 
 private:
+    struct UniformEntry
+    {
+        uint32_t hash;
+        GLint location;
+        std::string name;
+    };
+    // flat table of active uniforms sorted by name hash
+    std::vector<UniformEntry> uniformTable;
+
+    // query every active uniform after linking and store its location
+    // ------------------------------------------------------------------------
+    void cacheUniforms()
+    {
+        GLint count = 0, maxLen = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+        std::vector<char> nameBuf(maxLen > 0 ? maxLen : 1);
+        for (GLint i = 0; i < count; ++i)
+        {
+            GLsizei len = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuf.size(), &len, &size, &type, nameBuf.data());
+            std::string name(nameBuf.data(), len);
+            // arrays are reported as "name[0]", register the bare name and every element
+            std::string::size_type bracket = name.find('[');
+            std::string baseName = bracket == std::string::npos ? name : name.substr(0, bracket);
+            addUniform(baseName, glGetUniformLocation(ID, name.c_str()));
+            for (GLint element = 0; bracket != std::string::npos && element < size; ++element)
+            {
+                std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                addUniform(elementName, glGetUniformLocation(ID, elementName.c_str()));
+            }
+        }
+        std::sort(uniformTable.begin(), uniformTable.end(),
+            [](const UniformEntry& a, const UniformEntry& b) { return a.hash < b.hash; });
+#ifdef _DEBUG
+        std::clog << "INFO::SHADER::CACHED_UNIFORMS <" << uniformTable.size() << ">" << std::endl;
+#endif
+    }
+    void addUniform(const std::string& name, GLint location)
+    {
+        // members of uniform blocks have no location
+        if (location < 0)
+            return;
+        UniformEntry entry;
+        entry.hash = hashName(name.c_str());
+        entry.location = location;
+        entry.name = name;
+        uniformTable.push_back(entry);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     bool checkCompileErrors(unsigned int shader, std::string type)
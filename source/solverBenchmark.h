@@ -0,0 +1,408 @@
+#ifndef SOLVER_BENCHMARK_H
+#define SOLVER_BENCHMARK_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cubeBatch.h"
+#include "cubeCycles.h"
+#include "cubieCube.h"
+#include "moveSequence.h"
+#include "optimalSolver.h"
+#include "packedCube.h"
+#include "pruningTable.h"
+#include "transpositionTable.h"
+#include "twoPhaseSolver.h"
+#include "zobristHash.h"
+
+// Fixed scramble corpus so solver performance can be compared between versions, each with the length of its optimal
+// solution so a regression of the optimal solver that returns longer solutions fails the benchmark.
+// Kept short enough (8 - 13 moves) that the optimal solver finishes the whole corpus in a reasonable time.
+struct BenchmarkScramble
+{
+    const char* moves;
+    int optimalLength;
+};
+const BenchmarkScramble benchmarkScrambles[] = {
+    { "L' F B U L2 B U L2", 8 },
+    { "B2 R2 L' F B R' B' L2 U'", 9 },
+    { "B' L U L' D B R D' R' F'", 10 },
+    { "D' L D2 F' D' R2 B2 L' U R", 10 },
+    { "L2 U' D B2 L D2 R L2 D2 B2 R'", 11 },
+    { "R2 D2 F R F D2 F D' R' U D", 11 },
+    { "D2 B2 D2 R2 F' U B2 U' D F2 R' F2", 12 },
+    { "B R' D2 F2 D R2 U2 R' D2 R' B2 R", 12 },
+    { "L2 D' L' U2 D' F U L U2 D' L2 D' B", 13 },
+    { "R2 L D R2 D' R B' D' R2 U2 F2 U B", 13 }
+};
+
+// count pseudo-random moves in [0, kinds), face moves unless told otherwise (xorshift64 from seed, the same moves for
+// the same seed on every run)
+inline std::vector<int> randomMoves(uint64_t seed, size_t count, int kinds = FACE_MOVE_COUNT)
+{
+    std::vector<int> moves(count);
+    for (int& move : moves)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        move = (int)(seed % kinds);
+    }
+    return moves;
+}
+// the same for the slice moves of an order n cube
+inline std::vector<CubeMove> randomCubeMoves(uint64_t seed, size_t count, int n)
+{
+    std::vector<CubeMove> moves;
+    for (int move : randomMoves(seed, count, 3 * n * 2))
+        moves.push_back(CubeMove(move % 3, move / 3 % n, move / 3 / n ? 1 : -1));
+    return moves;
+}
+const uint64_t BENCHMARK_SEED = 88172645463325252ull;
+
+// Lookup cost of the pruning table encodings: one byte, 4 bits (PruningTable) & 2 bits mod 3 (Mod3PruningTable)
+// per entry, over UD slice edges (sorted) * twist, 26M entries. A random walk through the space looks up all 18
+// neighbours of every state the way IDA* does, the mod 3 lookups decode their distance from that of the walk.
+// Returns the number of decoded distances that differ from the 4-bit table.
+inline int runPruningTableBenchmark(std::ostream& out, size_t steps = 2000000)
+{
+    typedef std::chrono::steady_clock Clock;
+    const int twistCount = 2187, sliceCount = 11880;
+    TableArray<uint16_t> twistMove, sliceSortedMove;
+    loadMoveTable(twistMove, "twist_move", twistCount, &CubieCube::setTwist, &CubieCube::twist);
+    loadMoveTable(sliceSortedMove, "slice_sorted_move", sliceCount, &CubieCube::setSliceSorted, &CubieCube::sliceSorted);
+    auto neighbour = [&](size_t index, int m)
+    {
+        return (size_t)sliceSortedMove[index / twistCount * FACE_MOVE_COUNT + m] * twistCount + twistMove[index % twistCount * FACE_MOVE_COUNT + m];
+    };
+
+    Clock::time_point start = Clock::now();
+    PruningTable nibbles((size_t)sliceCount * twistCount);
+    // the solved slice edges may stand in any order of the slice, only their positions are sorted
+    const size_t solved = (size_t)CubieCube().sliceSorted() * twistCount;
+    nibbles.generate(&solved, 1, [&](size_t index, auto visit)
+    {
+        for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+            if (visit(neighbour(index, m)))
+                return;
+    });
+    std::vector<uint8_t> bytes(nibbles.size());
+    for (size_t i = 0; i < bytes.size(); ++i)
+        bytes[i] = (uint8_t)nibbles.get(i);
+    Mod3PruningTable residues;
+    residues.pack(nibbles);
+    out << "pruning table benchmark: " << nibbles.size() << " entries, generated in "
+        << std::chrono::duration<double>(Clock::now() - start).count() << " s" << std::endl;
+
+    // the same walk for every encoding, sum keeps the lookups from being optimized away
+    int mismatches = 0;
+    const std::vector<int> walkMoves = randomMoves(BENCHMARK_SEED, steps);
+    auto walk = [&](const char* label, size_t size, auto lookup)
+    {
+        uint64_t sum = 0;
+        size_t index = solved;
+        int distance = 0;
+        Clock::time_point begin = Clock::now();
+        for (size_t step = 0; step < steps; ++step)
+        {
+            int children[FACE_MOVE_COUNT];
+            for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+            {
+                children[m] = lookup(neighbour(index, m), distance);
+                sum += children[m];
+            }
+            const int m = walkMoves[step];
+            index = neighbour(index, m);
+            distance = children[m];
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        out << "    " << label << ": " << size / (1024.0 * 1024.0) << " MB, " << seconds * 1e9 / (steps * FACE_MOVE_COUNT)
+            << " ns per lookup (" << sum << ")" << std::endl;
+    };
+    walk("byte", bytes.size(), [&](size_t index, int)
+    {
+        return (int)bytes[index];
+    });
+    walk("4-bit", nibbles.byteSize(), [&](size_t index, int)
+    {
+        return nibbles.get(index);
+    });
+    walk("mod 3", residues.byteSize(), [&](size_t index, int parent)
+    {
+        const int distance = Mod3PruningTable::distance(parent, residues.get(index));
+        mismatches += distance != nibbles.get(index);
+        return distance;
+    });
+    // the check above is part of the timed loop, time the decode alone as well
+    walk("mod 3 unchecked", residues.byteSize(), [&](size_t index, int parent)
+    {
+        return Mod3PruningTable::distance(parent, residues.get(index));
+    });
+    if (mismatches)
+        out << "    mod 3 decode FAILED on " << mismatches << " lookups" << std::endl;
+    return mismatches;
+}
+
+// Move application rate of CubieCube, of PackedCube with each kernel this CPU runs & of a CubeBatch of 1M lanes on
+// up to threads threads (0 for every core), returns non-zero if one of them ends up in a different state than
+// CubieCube or the batch does not get faster with more cores.
+inline int runMoveBenchmark(std::ostream& out, int threads = 0, size_t moveCount = 1 << 20, int repeats = 16)
+{
+    typedef std::chrono::steady_clock Clock;
+    const std::vector<int> moves = randomMoves(BENCHMARK_SEED, moveCount);
+    auto rate = [&](Clock::time_point begin)
+    {
+        return moveCount * repeats / std::chrono::duration<double>(Clock::now() - begin).count() / 1e6;
+    };
+
+    CubieCube expected;
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < repeats; ++r)
+        for (int move : moves)
+            expected.applyMove(move);
+    out << "move benchmark: CubieCube " << rate(start) << " Mmoves/s" << std::endl;
+
+    int failures = 0;
+    const PackedCube::Kernel best = PackedCube::detectKernel();
+    static const char* const names[] = { "scalar", "SSSE3", "AVX2" };
+    for (int kernel = PackedCube::KERNEL_SCALAR; kernel <= best; ++kernel)
+    {
+        const PackedCube::Kernel selected = (PackedCube::Kernel)kernel;
+        PackedCube single, sequence;
+        start = Clock::now();
+        for (int r = 0; r < repeats; ++r)
+            for (const int& move : moves)
+                single.applyMoves(selected, &move, 1);
+        const double singleRate = rate(start);
+        start = Clock::now();
+        for (int r = 0; r < repeats; ++r)
+            sequence.applyMoves(selected, moves.data(), moves.size());
+        const double sequenceRate = rate(start);
+        const bool ok = single.toCubie() == expected && sequence.toCubie() == expected;
+        failures += !ok;
+        out << "    PackedCube " << names[kernel] << ": applyMove " << singleRate << " Mmoves/s, applyMoves " << sequenceRate
+            << " Mmoves/s" << (ok ? "" : "  FAILED") << std::endl;
+    }
+
+    // the batch only turns every lane a few thousand times, its first & last lane are checked against a CubieCube.
+    // It runs on 1, 2, 4, ... threads up to threads (2 at least, so the pool always runs) & has to get faster with
+    // every thread count up to the cores of this CPU
+    CubieCube lane;
+    const size_t batchMoves = 4096;
+    for (size_t i = 0; i < batchMoves; ++i)
+        lane.applyMove(moves[i]);
+    const int cores = std::max(1, (int)std::thread::hardware_concurrency());
+    const int mostThreads = std::max(2, threads > 0 ? threads : cores);
+    double singleRate = 0.0;
+    for (int t = 1; t <= mostThreads; t = t < mostThreads ? std::min(t * 2, mostThreads) : t + 1)
+    {
+        CubeBatch batch(1 << 20, t);
+        start = Clock::now();
+        for (size_t i = 0; i < batchMoves; ++i)
+            batch.applyMove(moves[i]);
+        const double batchRate = batch.size() * batchMoves / std::chrono::duration<double>(Clock::now() - start).count() / 1e6;
+        if (t == 1)
+            singleRate = batchRate;
+        const bool ok = batch.get(0) == lane && batch.get(batch.size() - 1) == lane;
+        // more threads than cores cannot be faster
+        const bool faster = t == 1 || t > cores || batchRate > singleRate * 1.1;
+        failures += !ok + !faster;
+        out << "    CubeBatch " << batch.size() << " lanes, " << t << (t == 1 ? " thread: " : " threads: ") << batchRate
+            << " Mmoves/s, " << batchRate / singleRate << "x" << (ok ? "" : "  FAILED") << (faster ? "" : "  NO SPEEDUP") << std::endl;
+    }
+    return failures;
+}
+
+// Order & cycle structure of a few 3x3x3 algorithms, then order & power of a long random sequence on the largest
+// cube: cubePower() against applying the composed permutation k times. Returns the number of wrong results.
+inline int runCycleBenchmark(std::ostream& out, int repeats = 1000)
+{
+    typedef std::chrono::steady_clock Clock;
+    static const char* const algorithms[] = { "R U", "R U R' U'", "R U2 D' B D'", "F2 R2 U2" };
+    int failures = 0;
+    for (const char* algorithm : algorithms)
+    {
+        std::vector<int> moves;
+        parseFaceMoves(algorithm, moves);
+        const CubieCube cube = composeFaceMoves(moves);
+        const uint64_t order = cubieOrder(cube);
+        // a huge power equals the small one it is congruent to
+        const bool ok = cubiePower(cube, order) == CubieCube() && cubiePower(cube, order * 1000000007 + 5) == cubiePower(cube, 5);
+        failures += !ok;
+        out << "cycles " << algorithm << ": order " << order << ", " << cubieCycleStructure(cube) << (ok ? "" : "  FAILED") << std::endl;
+    }
+
+    const int n = CUBE_MAX_ORDER;
+    DynamicCube permutation(n);
+    const std::vector<CubeMove> moves = randomCubeMoves(BENCHMARK_SEED, 1000, n);
+    composeMoves(moves.data(), moves.size(), permutation);
+    Clock::time_point start = Clock::now();
+    const BigUnsigned order = cubeOrder(permutation);
+    const double orderSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    start = Clock::now();
+    DynamicCube repeated(n);
+    for (int r = 0; r < repeats; ++r)
+        repeated.applyPermutation(permutation);
+    const double repeatedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    start = Clock::now();
+    const DynamicCube power = cubePower(permutation, BigUnsigned(repeats));
+    const double powerSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    const bool ok = power == repeated && cubePower(permutation, order).isSolved() && !cubePower(permutation, BigUnsigned(repeats)).isSolved();
+    failures += !ok;
+    out << "cycles " << n << "x" << n << "x" << n << ", " << moves.size() << " random moves: order " << order.toString() << " ("
+        << orderSeconds * 1000.0 << " ms), power " << repeats << " " << powerSeconds * 1000.0 << " ms, repeated "
+        << repeatedSeconds * 1000.0 << " ms" << (ok ? "" : "  FAILED") << std::endl;
+    return failures;
+}
+
+// depth-first walk over the face move sequences up to remaining moves long that do not turn one face twice in a row,
+// skipping states the table already saw with as many moves to go (e.g. U D after D U). Counts the states it finds
+// no entry for & the hashes that differ from a full rehash (if check is set)
+inline void transpositionWalk(TranspositionTable& table, const CubieCube& cube, uint64_t hash, int remaining, int lastFace,
+                              bool check, uint64_t& found, uint64_t& wrong)
+{
+    if (check && hash != ZobristHash::of(cube))
+        ++wrong;
+    TranspositionTable::Entry entry;
+    if (!table.probe(hash, entry))
+        ++found;
+    else if (entry.depth >= remaining)
+        return;
+    table.store(hash, TranspositionTable::Entry{ 0, (uint8_t)remaining, 0 });
+    if (remaining == 0)
+        return;
+    for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+    {
+        const int face = m / 3;
+        if (face == lastFace)
+            continue;
+        CubieCube next = cube;
+        const uint64_t nextHash = ZobristHash::applyMove(next, hash, m);
+        transpositionWalk(table, next, nextHash, remaining - 1, face, check, found, wrong);
+    }
+}
+
+// Zobrist hashing & the transposition table: every state within 5 face moves (621649) is found through a table with
+// room for them all, once each unless its entry was replaced & it came up again. Then all threads share a table of
+// the same size for the 8.3M states within 6 moves, too many for it. Last the incremental hash of an NxNxN cube
+// against a full rehash after every move.
+// Returns the number of wrong counts & hashes.
+inline int runTranspositionBenchmark(std::ostream& out, int threads = 0, size_t megabytes = 32)
+{
+    typedef std::chrono::steady_clock Clock;
+    if (threads <= 0)
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    auto report = [&](const char* name, int depth, uint64_t found, const TranspositionTable& table, Clock::time_point start)
+    {
+        const TranspositionTable::Statistics stats = table.statistics();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        out << "    " << name << " depth " << depth << ": " << found << " states, " << stats.probes / seconds / 1e6 << " Mprobes/s, hit rate "
+            << stats.hitRate() * 100.0 << "%, " << stats.replacements << " replacements, " << stats.dropped << " dropped, "
+            << table.fill() * 100.0 << "% full" << std::endl;
+    };
+
+    TranspositionTable table(megabytes);
+    out << "transposition table: " << table.capacity() << " entries, " << table.byteSize() / (1 << 20) << " MB" << std::endl;
+    uint64_t found = 0, wrong = 0;
+    Clock::time_point start = Clock::now();
+    transpositionWalk(table, CubieCube(), ZobristHash::of(CubieCube()), 5, -1, true, found, wrong);
+    const bool exact = found >= 621649 && found <= 621649 + table.statistics().replacements && wrong == 0;
+    report("1 thread", 5, found, table, start);
+
+    // the threads take the first moves one by one
+    table.clear();
+    std::atomic<int> nextMove(0);
+    std::atomic<uint64_t> sharedFound(1);
+    table.store(ZobristHash::of(CubieCube()), TranspositionTable::Entry{ 0, 6, 0 });
+    start = Clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&]()
+        {
+            uint64_t count = 0, unused = 0;
+            for (int m = nextMove++; m < FACE_MOVE_COUNT; m = nextMove++)
+            {
+                CubieCube cube;
+                const uint64_t hash = ZobristHash::applyMove(cube, ZobristHash::of(CubieCube()), m);
+                transpositionWalk(table, cube, hash, 5, m / 3, false, count, unused);
+            }
+            sharedFound += count;
+        });
+    for (std::thread& worker : workers)
+        worker.join();
+    report(threads == 1 ? "1 thread" : (std::to_string(threads) + " threads").c_str(), 6, sharedFound, table, start);
+
+    const int n = CUBE_MAX_ORDER;
+    DynamicCube cube(n);
+    uint64_t hash = ZobristHash::of(cube);
+    int mismatches = 0;
+    for (const CubeMove& move : randomCubeMoves(BENCHMARK_SEED, 200, n))
+    {
+        hash = ZobristHash::applyMove(cube, hash, move);
+        mismatches += hash != ZobristHash::of(cube);
+    }
+    out << "    incremental hash of a " << n << "x" << n << "x" << n << " cube" << (mismatches ? "  FAILED" : " ok") << std::endl;
+    if (!exact)
+        out << "    depth 5 count FAILED: " << found << " states, " << wrong << " wrong hashes" << std::endl;
+    return !exact + mismatches;
+}
+
+// solve the corpus with both solvers & report length, time & node rate of each scramble, returns non-zero on failure
+inline int runSolverBenchmark(std::ostream& out, int threads = 0)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    const TwoPhaseSolver& twoPhase = TwoPhaseSolver::get();
+    out << "two-phase tables: " << std::chrono::duration<double>(Clock::now() - start).count() << " s" << std::endl;
+    start = Clock::now();
+    const OptimalSolver& optimal = OptimalSolver::get();
+    out << "optimal tables: " << std::chrono::duration<double>(Clock::now() - start).count() << " s" << std::endl;
+
+    int failures = 0;
+    double twoPhaseSeconds = 0.0, optimalSeconds = 0.0;
+    uint64_t twoPhaseNodes = 0, optimalNodes = 0, optimalCutoffs = 0;
+    for (const BenchmarkScramble& scramble : benchmarkScrambles)
+    {
+        std::vector<int> moves;
+        parseFaceMoves(scramble.moves, moves);
+        const CubieCube cube = composeFaceMoves(moves);
+
+        TwoPhaseSolver::Result fast = twoPhase.solve(cube);
+        OptimalSolver::Result best = optimal.solve(cube, threads);
+        // both solutions must actually solve the scramble, the optimal one in the known optimal length
+        CubieCube fastCheck = cube, bestCheck = cube;
+        fastCheck.multiply(composeFaceMoves(fast.moves));
+        bestCheck.multiply(composeFaceMoves(best.moves));
+        bool ok = fast.found && best.found && fastCheck == CubieCube() && bestCheck == CubieCube()
+            && (int)best.moves.size() == scramble.optimalLength;
+        failures += !ok;
+
+        twoPhaseSeconds += fast.seconds;
+        twoPhaseNodes += fast.phase1Nodes + fast.phase2Nodes;
+        optimalSeconds += best.seconds;
+        optimalNodes += best.nodes;
+        optimalCutoffs += best.cutoffs;
+        out << scramble.moves << std::endl
+            << "    two-phase " << fast.moves.size() << " moves, " << fast.seconds * 1000.0 << " ms, "
+            << fast.phase1Nodes + fast.phase2Nodes << " nodes" << std::endl
+            << "    optimal " << best.moves.size() << " moves, " << best.seconds * 1000.0 << " ms, " << best.nodes << " nodes, "
+            << best.cutoffs << " transpositions, " << best.nodes / best.seconds / 1e6 << " Mnodes/s"
+            << (ok ? "" : "  FAILED, optimal is " + std::to_string(scramble.optimalLength) + " moves") << std::endl;
+    }
+    out << "two-phase total: " << twoPhaseSeconds << " s, " << twoPhaseNodes / twoPhaseSeconds / 1e6 << " Mnodes/s" << std::endl
+        << "optimal total: " << optimalSeconds << " s, " << optimalNodes / optimalSeconds / 1e6 << " Mnodes/s" << std::endl;
+    const TranspositionTable& table = optimal.transpositionTable();
+    const TranspositionTable::Statistics stats = table.statistics();
+    out << "optimal transposition table: " << optimalCutoffs << " subtrees skipped, " << stats.probes << " probes, hit rate "
+        << stats.hitRate() * 100.0 << "%, " << stats.replacements << " replacements, " << stats.dropped << " dropped, "
+        << table.fill() * 100.0 << "% full" << std::endl;
+    return failures + (runPruningTableBenchmark(out) != 0) + runMoveBenchmark(out, threads) + runCycleBenchmark(out)
+        + runTranspositionBenchmark(out, threads);
+}
+#endif
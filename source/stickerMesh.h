@@ -0,0 +1,63 @@
+#ifndef STICKER_MESH_H
+#define STICKER_MESH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "cubeState.h"
+
+// Faces of a cubie, in the same order as the face table of the vertex shader
+enum CubieFace
+{
+    FACE_BACK = 0,      // -z
+    FACE_FRONT = 1,     // +z
+    FACE_LEFT = 2,      // -x
+    FACE_RIGHT = 3,     // +x
+    FACE_BOTTOM = 4,    // -y
+    FACE_TOP = 5        // +y
+};
+
+// Only the outward-facing faces of the surface cubies are ever visible, so instead of full cubies
+// the magic cube is drawn as one quad ("sticker") per visible face, 6 * N * N quads in total.
+// A cubie keeps its stickers while it moves, and slice turns never move a cubie between
+// the surface and the inside, so both tables below are built once for a given order.
+class StickerMesh
+{
+public:
+    // slots on the surface of the cube, whatever cubie sits there carries stickers
+    std::vector<int> surfaceSlots;
+    // bit f is set when face f of the cubie (identified by its home slot) is a sticker
+    std::vector<uint8_t> stickerFaces;
+    int stickerCount;
+
+    explicit StickerMesh(int order) : stickerFaces(order * order * order, 0), stickerCount(0)
+    {
+        for (int slot = 0; slot < order * order * order; ++slot)
+        {
+            // slot = x + z * n + y * n * n
+            int coord[3] = { slot % order, slot / (order * order), slot / order % order };
+            uint8_t faces = 0;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (coord[axis] == 0)
+                    faces |= 1 << faceOf(axis, -1);
+                if (coord[axis] == order - 1)
+                    faces |= 1 << faceOf(axis, 1);
+            }
+            if (!faces)
+                continue;
+            surfaceSlots.push_back(slot);
+            stickerFaces[slot] = faces;
+            for (int face = 0; face < 6; ++face)
+                stickerCount += faces >> face & 1;
+        }
+    }
+
+    // face whose outward normal points along +/- axis
+    static int faceOf(int axis, int sign)
+    {
+        static const int faces[3][2] = { { FACE_LEFT, FACE_RIGHT }, { FACE_BOTTOM, FACE_TOP }, { FACE_BACK, FACE_FRONT } };
+        return faces[axis][sign > 0];
+    }
+};
+#endif
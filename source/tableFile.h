@@ -0,0 +1,309 @@
+#ifndef TABLE_FILE_H
+#define TABLE_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+// glad defines APIENTRY as __stdcall when included first, windows.h redefines it to the same (warning C4005)
+#ifdef APIENTRY
+#undef APIENTRY
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// On-disk format of the solver tables: a fixed header, then the raw table starting at the next page boundary
+// so the payload can be used straight from a read-only memory mapping. The OS pages it in lazily on first
+// access & shares the pages between every process that maps the same file.
+
+// raise whenever the layout of a table changes, files of other versions are generated anew
+// 2: phase 1 & corner tables reduced by symmetry, 3: large pruning tables stored as distances modulo 3
+const uint32_t TABLE_FILE_VERSION = 3;
+const size_t TABLE_FILE_ALIGNMENT = 4096;
+
+// directory of the table files, relative to the working directory
+inline std::string& tableDirectory()
+{
+    static std::string path = "resource/table";
+    return path;
+}
+
+struct TableFileHeader
+{
+    char magic[8];              // "OGLMCTBL"
+    uint32_t version;           // TABLE_FILE_VERSION
+    uint32_t headerSize;        // sizeof(TableFileHeader)
+    char name[32];              // which table the file holds, zero padded
+    uint64_t entries;
+    uint64_t payloadOffset;     // multiple of TABLE_FILE_ALIGNMENT
+    uint64_t payloadSize;       // bytes
+    uint64_t checksum;          // tableChecksum() of the payload
+};
+
+// FNV-1a over 64-bit words (the tail byte-wise), cheap enough to run over a few hundred MB
+inline uint64_t tableChecksum(const uint8_t* data, size_t size)
+{
+    uint64_t h = 14695981039346656037ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * 1099511628211ull;
+    }
+    for (; i < size; ++i)
+        h = (h ^ data[i]) * 1099511628211ull;
+    return h;
+}
+
+// read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() : view(nullptr), length(0)
+    {
+#ifdef _WIN32
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#else
+        fd = -1;
+#endif
+    }
+    ~MappedFile()
+    {
+        close();
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path)
+    {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        length = (size_t)fileSize.QuadPart;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL)
+        {
+            close();
+            return false;
+        }
+        view = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat status;
+        if (fstat(fd, &status) != 0 || status.st_size == 0)
+        {
+            close();
+            return false;
+        }
+        length = (size_t)status.st_size;
+        void* address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        view = address == MAP_FAILED ? nullptr : (const uint8_t*)address;
+#endif
+        if (!view)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (view)
+            UnmapViewOfFile(view);
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (view)
+            munmap((void*)view, length);
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+#endif
+        view = nullptr;
+        length = 0;
+    }
+
+    const uint8_t* data() const
+    {
+        return view;
+    }
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+    const uint8_t* view;
+    size_t length;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+};
+
+// write a table file, through a temporary file of this process so a reader never sees a half written table & two
+// processes generating the same table do not write into one temporary file
+inline bool writeTableFile(const std::string& path, const char* name, uint64_t entries, const uint8_t* payload, size_t size)
+{
+    TableFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "OGLMCTBL", 8);
+    header.version = TABLE_FILE_VERSION;
+    header.headerSize = sizeof(TableFileHeader);
+    std::strncpy(header.name, name, sizeof(header.name) - 1);
+    header.entries = entries;
+    header.payloadOffset = TABLE_FILE_ALIGNMENT;
+    header.payloadSize = size;
+    header.checksum = tableChecksum(payload, size);
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+#ifdef _WIN32
+    const unsigned long process = GetCurrentProcessId();
+#else
+    const unsigned long process = (unsigned long)getpid();
+#endif
+    const std::string temporary = path + "." + std::to_string(process) + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file)
+        return false;
+    static const uint8_t padding[TABLE_FILE_ALIGNMENT] = { 0 };
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(padding, TABLE_FILE_ALIGNMENT - sizeof(header), 1, file) == 1
+        && std::fwrite(payload, 1, size, file) == size;
+    ok = std::fclose(file) == 0 && ok;
+    // replace an existing file in one step, a reader finds either the old table or the new one but never none
+#ifdef _WIN32
+    ok = ok && MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    ok = ok && std::rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+    if (!ok)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// map a table file & check that it holds the expected table, the payload checksum is only verified on request
+// since reading the whole payload is exactly what the mapping avoids. The tables verify a file once, when they map
+// it right after writing it
+inline const uint8_t* openTableFile(MappedFile& file, const std::string& path, const char* name, uint64_t entries, size_t size,
+                                    bool verify = false)
+{
+    if (!file.open(path) || file.size() < sizeof(TableFileHeader))
+        return nullptr;
+    TableFileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    char expectedName[sizeof(header.name)] = { 0 };
+    std::strncpy(expectedName, name, sizeof(expectedName) - 1);
+    const uint8_t* payload = file.data() + header.payloadOffset;
+    if (std::memcmp(header.magic, "OGLMCTBL", 8) != 0 || header.version != TABLE_FILE_VERSION
+        || header.headerSize != sizeof(TableFileHeader) || std::memcmp(header.name, expectedName, sizeof(expectedName)) != 0
+        || header.entries != entries || header.payloadSize != size || header.payloadOffset % TABLE_FILE_ALIGNMENT != 0
+        || header.payloadOffset + size > file.size() || (verify && tableChecksum(payload, size) != header.checksum))
+    {
+        file.close();
+        return nullptr;
+    }
+    return payload;
+}
+
+// array of plain values (e.g. a move table) kept in a table file, generated on the first start & mapped afterwards
+template<class T>
+class TableArray
+{
+public:
+    const T& operator[](size_t index) const
+    {
+        return values[index];
+    }
+    size_t size() const
+    {
+        return count;
+    }
+
+    // generate(vector) fills the values when <tableDirectory()>/<name>.tab is missing or stale
+    template<class Generate>
+    void loadOrGenerate(const char* name, size_t size, Generate generate)
+    {
+        const std::string path = tableDirectory() + "/" + name + ".tab";
+        file = std::make_shared<MappedFile>();
+        const uint8_t* payload = openTableFile(*file, path, name, size, size * sizeof(T));
+        if (payload)
+        {
+            owned.clear();
+            values = (const T*)payload;
+            count = size;
+            return;
+        }
+        file.reset();
+        owned.assign(size, T());
+        generate(owned);
+        values = owned.data();
+        count = size;
+        if (!writeTableFile(path, name, size, (const uint8_t*)owned.data(), size * sizeof(T)))
+        {
+            std::cerr << "WARNING::TABLE_FILE::SAVE_FAILED <" << path << ">" << std::endl;
+            return;
+        }
+        // read back what was written, the values generated stay in use if it does not check out
+        std::shared_ptr<MappedFile> written = std::make_shared<MappedFile>();
+        payload = openTableFile(*written, path, name, size, size * sizeof(T), true);
+        if (!payload)
+        {
+            std::cerr << "WARNING::TABLE_FILE::VERIFY_FAILED <" << path << ">" << std::endl;
+            return;
+        }
+        file = written;
+        values = (const T*)payload;
+        owned = std::vector<T>();
+    }
+
+private:
+    std::vector<T> owned;
+    std::shared_ptr<MappedFile> file;
+    const T* values = nullptr;
+    size_t count = 0;
+};
+#endif
@@ -0,0 +1,241 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-size hash table of search results per state (keyed by a 64-bit state hash, see ZobristHash), shared by
+// any number of threads without locks.
+//
+// Buckets of 4 entries fill one cache line, the low bits of the hash pick the bucket. Every entry is two 64-bit
+// words, the packed data & the hash XOR that data, each written & read atomically but not together: an entry
+// half overwritten by another thread does not check out against its hash & reads as a miss, so no lock is
+// needed & a race costs at most a lost result, never a wrong one.
+// Replacement: an entry of the same state is overwritten unless it comes from this search (generation) & went
+// deeper, otherwise an empty entry is used, otherwise the entry worth least, older searches first & then the
+// shallowest. A store that finds all 4 entries from this search & deeper is dropped.
+// The counters (hit rate, replacements of other states i.e. bucket collisions, dropped stores) tell whether the
+// table is large enough for a search: replacements & drops climb steeply once it is not. They are spread over
+// cache lines so threads do not fight over them.
+class TranspositionTable
+{
+public:
+    static const int BUCKET_SIZE = 4;
+
+    // what is kept per state
+    struct Entry
+    {
+        uint16_t value;   // e.g. a bound on the distance to solved
+        uint8_t depth;    // how deep the search below the state went, deeper entries are kept longer
+        uint32_t payload; // anything else, e.g. a best move
+    };
+
+    struct Statistics
+    {
+        uint64_t probes;
+        uint64_t hits;
+        uint64_t stores;
+        uint64_t replacements;
+        uint64_t dropped;
+
+        double hitRate() const
+        {
+            return probes ? (double)hits / probes : 0.0;
+        }
+    };
+
+    // largest power of 2 of buckets that fits into megabytes
+    explicit TranspositionTable(size_t megabytes) : generation(0)
+    {
+        size_t bucketCount = 1;
+        while (bucketCount * 2 * sizeof(Bucket) <= megabytes << 20)
+            bucketCount *= 2;
+        buckets = std::vector<Bucket>(bucketCount);
+        mask = bucketCount - 1;
+        clear();
+    }
+
+    size_t capacity() const
+    {
+        return buckets.size() * BUCKET_SIZE;
+    }
+    size_t byteSize() const
+    {
+        return buckets.size() * sizeof(Bucket);
+    }
+
+    // forget every entry & reset the counters, not while other threads use the table
+    void clear()
+    {
+        for (Bucket& bucket : buckets)
+            for (Slot& slot : bucket.slot)
+            {
+                slot.check.store(0, std::memory_order_relaxed);
+                slot.data.store(0, std::memory_order_relaxed);
+            }
+        for (Counters& counter : counters)
+            for (std::atomic<uint64_t>& count : counter.count)
+                count.store(0, std::memory_order_relaxed);
+        generation.store(0, std::memory_order_relaxed);
+    }
+    // start a new search, entries of earlier ones are replaced first
+    void newGeneration()
+    {
+        generation.store((generation.load(std::memory_order_relaxed) + 1) & GENERATION_MASK, std::memory_order_relaxed);
+    }
+
+    bool probe(uint64_t hash, Entry& entry)
+    {
+        Counters& counter = countersOf(hash);
+        add(counter, PROBES);
+        const Bucket& bucket = buckets[hash & mask];
+        for (const Slot& slot : bucket.slot)
+        {
+            const uint64_t data = slot.data.load(std::memory_order_relaxed);
+            if (data != 0 && (slot.check.load(std::memory_order_relaxed) ^ data) == hash)
+            {
+                entry = unpack(data);
+                add(counter, HITS);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void store(uint64_t hash, const Entry& entry)
+    {
+        Counters& counter = countersOf(hash);
+        const uint64_t current = generation.load(std::memory_order_relaxed);
+        Bucket& bucket = buckets[hash & mask];
+        Slot* victim = nullptr;
+        int victimWorth = INT_MAX;
+        for (Slot& slot : bucket.slot)
+        {
+            const uint64_t data = slot.data.load(std::memory_order_relaxed);
+            const int age = (int)((current - (data >> GENERATION_SHIFT & GENERATION_MASK)) & GENERATION_MASK);
+            const int depth = (int)(data >> DEPTH_SHIFT & 0xFF);
+            if (data != 0 && (slot.check.load(std::memory_order_relaxed) ^ data) == hash)
+            {
+                // same state: keep a deeper result of this search
+                if (age == 0 && depth > entry.depth)
+                {
+                    add(counter, DROPPED);
+                    return;
+                }
+                write(slot, hash, pack(entry, current));
+                add(counter, STORES);
+                return;
+            }
+            // empty entries are worth least, the others their depth less 256 for every search they are old
+            const int worth = data == 0 ? INT_MIN : depth - age * 256;
+            if (worth < victimWorth)
+            {
+                victim = &slot;
+                victimWorth = worth;
+            }
+        }
+        // only entries of this search that went deeper are worth more
+        if (victimWorth > entry.depth)
+        {
+            add(counter, DROPPED);
+            return;
+        }
+        write(*victim, hash, pack(entry, current));
+        add(counter, STORES);
+        if (victimWorth != INT_MIN)
+            add(counter, REPLACEMENTS);
+    }
+
+    Statistics statistics() const
+    {
+        uint64_t sum[COUNTER_COUNT] = { 0 };
+        for (const Counters& counter : counters)
+            for (int i = 0; i < COUNTER_COUNT; ++i)
+                sum[i] += counter.count[i].load(std::memory_order_relaxed);
+        Statistics result = { sum[PROBES], sum[HITS], sum[STORES], sum[REPLACEMENTS], sum[DROPPED] };
+        return result;
+    }
+    // entries in use, counted over the first buckets only
+    double fill(size_t sampleBuckets = 1 << 12) const
+    {
+        const size_t count = std::min(sampleBuckets, buckets.size());
+        size_t used = 0;
+        for (size_t b = 0; b < count; ++b)
+            for (const Slot& slot : buckets[b].slot)
+                used += slot.data.load(std::memory_order_relaxed) != 0;
+        return (double)used / (count * BUCKET_SIZE);
+    }
+
+private:
+    // data word: value (bits 0 - 15), depth (16 - 23), payload (24 - 55), generation (56 - 62) & a set bit 63,
+    // so no stored entry is all zero like an empty one
+    static const int DEPTH_SHIFT = 16;
+    static const int PAYLOAD_SHIFT = 24;
+    static const int GENERATION_SHIFT = 56;
+    static const uint64_t GENERATION_MASK = 0x7F;
+    static const uint64_t USED = 1ull << 63;
+
+    enum Counter
+    {
+        PROBES,
+        HITS,
+        STORES,
+        REPLACEMENTS,
+        DROPPED,
+        COUNTER_COUNT
+    };
+    static const int COUNTER_STRIPES = 64;
+
+    struct Slot
+    {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+    struct alignas(64) Bucket
+    {
+        Slot slot[BUCKET_SIZE];
+    };
+    struct alignas(64) Counters
+    {
+        std::atomic<uint64_t> count[COUNTER_COUNT];
+    };
+
+    std::vector<Bucket> buckets;
+    size_t mask;
+    std::atomic<uint64_t> generation;
+    Counters counters[COUNTER_STRIPES];
+
+    static uint64_t pack(const Entry& entry, uint64_t generation)
+    {
+        return entry.value | (uint64_t)entry.depth << DEPTH_SHIFT | (uint64_t)entry.payload << PAYLOAD_SHIFT
+            | generation << GENERATION_SHIFT | USED;
+    }
+    static void write(Slot& slot, uint64_t hash, uint64_t data)
+    {
+        slot.data.store(data, std::memory_order_relaxed);
+        slot.check.store(hash ^ data, std::memory_order_relaxed);
+    }
+    static Entry unpack(uint64_t data)
+    {
+        Entry entry;
+        entry.value = (uint16_t)data;
+        entry.depth = (uint8_t)(data >> DEPTH_SHIFT);
+        entry.payload = (uint32_t)(data >> PAYLOAD_SHIFT);
+        return entry;
+    }
+
+    // stripe by the hash bits above the bucket index, threads working on different states rarely share one
+    Counters& countersOf(uint64_t hash)
+    {
+        return counters[hash >> 58 & (COUNTER_STRIPES - 1)];
+    }
+    static void add(Counters& counter, Counter which)
+    {
+        counter.count[which].fetch_add(1, std::memory_order_relaxed);
+    }
+};
+#endif
@@ -0,0 +1,307 @@
+#ifndef TWO_PHASE_SOLVER_H
+#define TWO_PHASE_SOLVER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "cubeSymmetry.h"
+#include "cubieCube.h"
+#include "packedCube.h"
+#include "pruningTable.h"
+
+// Kociemba's two-phase algorithm.
+//
+// Phase 1 brings the cube into the subgroup <U, D, R2, L2, F2, B2> (no twist, no flip, UD slice edges in
+// the slice), phase 2 solves it with those moves only. Both phases are IDA* searches over coordinates
+// with move tables & pruning tables as heuristics. The phase 1 table covers flip, slice position & twist at
+// once, reduced by the 16 symmetries that keep the UD axis (flip & slice are combined into 64430 classes,
+// the twist is conjugated along), which makes it about 16 times smaller than the plain product. It only
+// stores distances modulo 3 (see Mod3PruningTable), so the search carries the exact phase 1 distance along.
+// Once a solution is found the search goes on with longer phase 1 solutions as long as that shortens the
+// total, until targetLength or the time limit.
+// All tables are generated once into table files (see tableFile.h), later starts map them.
+// The tables are built on first use and shared, solve() is safe to call from several threads at once.
+class TwoPhaseSolver
+{
+public:
+    static const int TWIST_COUNT = 2187;
+    static const int FLIP_COUNT = 2048;
+    static const int SLICE_SORTED_COUNT = 11880;
+    static const int SLICE_COUNT = 495;
+    static const int FLIP_SLICE_COUNT = SLICE_COUNT * FLIP_COUNT;
+    static const int PERM_COUNT = 40320;
+    static const int SLICE_PERM_COUNT = 24;
+    static const int PHASE2_MOVE_COUNT = 10;
+    static const int MAX_LENGTH = 30;
+
+    struct Result
+    {
+        std::vector<int> moves;     // face moves, see faceMoveName()
+        bool found = false;
+        int phase1Length = 0;
+        double seconds = 0.0;       // search time, without building the tables
+        uint64_t phase1Nodes = 0;
+        uint64_t phase2Nodes = 0;
+    };
+
+    // the tables take a moment to build, the first call should happen off the render thread
+    static const TwoPhaseSolver& get()
+    {
+        static const TwoPhaseSolver solver;
+        return solver;
+    }
+
+    // solve the cube, stop improving once the solution has at most targetLength moves or timeLimit seconds passed
+    Result solve(const CubieCube& cube, int targetLength = 20, double timeLimit = 0.1) const
+    {
+        Search search(*this, cube, targetLength, timeLimit);
+        search.run();
+        return search.result;
+    }
+
+private:
+    // move tables, coordinate * FACE_MOVE_COUNT + move
+    TableArray<uint16_t> twistMove, flipMove, sliceSortedMove, cornerPermMove, udEdgePermMove;
+    // twist of each symmetry conjugate, twist * SYM_UD_COUNT + sym
+    TableArray<uint16_t> twistConjugate;
+    // slice position * FLIP_COUNT + flip reduced by the UD symmetries
+    SymCoordinate flipSliceSym;
+    // phase 1 pruning table over flip slice class * TWIST_COUNT + conjugated twist
+    Mod3PruningTable phase1Prune;
+    // phase 2 pruning tables, depth of each coordinate pair
+    PruningTable cornerSlicePrune, edgeSlicePrune;
+
+    // moves allowed in phase 2
+    static const int* phase2Moves()
+    {
+        static const int moves[PHASE2_MOVE_COUNT] = { 0, 1, 2, 4, 7, 9, 10, 11, 13, 16 };
+        return moves;
+    }
+    static bool isPhase2Move(int move)
+    {
+        int face = move / 3;
+        return face == SIDE_U || face == SIDE_D || move % 3 == 1;
+    }
+    // a face is never turned twice in a row & of two opposite faces only the order U D, R L, F B is searched
+    static bool skipFace(int face, int lastFace)
+    {
+        return lastFace >= 0 && (face == lastFace || face == lastFace - 3);
+    }
+
+    TwoPhaseSolver()
+    {
+        loadMoveTable(twistMove, "twist_move", TWIST_COUNT, &CubieCube::setTwist, &CubieCube::twist);
+        loadMoveTable(flipMove, "flip_move", FLIP_COUNT, &CubieCube::setFlip, &CubieCube::flip);
+        loadMoveTable(sliceSortedMove, "slice_sorted_move", SLICE_SORTED_COUNT, &CubieCube::setSliceSorted, &CubieCube::sliceSorted);
+        loadMoveTable(cornerPermMove, "corner_perm_move", PERM_COUNT, &CubieCube::setCornerPerm, &CubieCube::cornerPerm);
+        // the U & D edges only stay in the U & D faces under phase 2 moves
+        loadMoveTable(udEdgePermMove, "ud_edge_perm_move", PERM_COUNT, &CubieCube::setUdEdgePerm, &CubieCube::udEdgePerm, isPhase2Move);
+
+        loadTwistConjugateTable(twistConjugate);
+        flipSliceSym.loadOrGenerate("flip_slice_sym", FLIP_SLICE_COUNT, SYM_UD_COUNT, [](int flipSlice, int sym)
+        {
+            CubieCube cube;
+            cube.setSliceSorted(flipSlice / FLIP_COUNT * 24);
+            cube.setFlip(flipSlice % FLIP_COUNT);
+            CubieCube image = CubeSymmetry::get().conjugate(cube, sym);
+            return image.sliceSorted() / 24 * FLIP_COUNT + image.flip();
+        });
+        buildPhase1Table();
+        // phase 2: slice edge permutation paired with corner & with U / D edge permutation
+        buildPruneTable(cornerSlicePrune, "twophase_corner_slice", SLICE_PERM_COUNT, PERM_COUNT, true, [this](int slice, int corner, int m, int& nextSlice, int& nextCorner)
+        {
+            nextSlice = sliceSortedMove[slice * FACE_MOVE_COUNT + m];
+            nextCorner = cornerPermMove[corner * FACE_MOVE_COUNT + m];
+        });
+        buildPruneTable(edgeSlicePrune, "twophase_edge_slice", SLICE_PERM_COUNT, PERM_COUNT, true, [this](int slice, int edge, int m, int& nextSlice, int& nextEdge)
+        {
+            nextSlice = sliceSortedMove[slice * FACE_MOVE_COUNT + m];
+            nextEdge = udEdgePermMove[edge * FACE_MOVE_COUNT + m];
+        });
+    }
+
+    // phase 1 / phase 2 pruning table over major * minorCount + minor, movePair turns both coordinates
+    template<class MovePair>
+    static void buildPruneTable(PruningTable& table, const char* name, int majorCount, int minorCount, bool phase2, MovePair movePair)
+    {
+        table.loadOrGenerate(name, (size_t)majorCount * minorCount, [=](PruningTable& table)
+        {
+            const size_t solved = 0;
+            table.generate(&solved, 1, [=](size_t entry, auto visit)
+            {
+                int major = (int)(entry / minorCount), minor = (int)(entry % minorCount);
+                for (int i = 0; i < (phase2 ? PHASE2_MOVE_COUNT : FACE_MOVE_COUNT); ++i)
+                {
+                    int nextMajor, nextMinor;
+                    movePair(major, minor, phase2 ? phase2Moves()[i] : i, nextMajor, nextMinor);
+                    if (visit((size_t)nextMajor * minorCount + nextMinor))
+                        return;
+                }
+            });
+        });
+    }
+
+    // BFS over the symmetry classes, every neighbour is brought to its class. A representative with symmetries of
+    // its own stands for several twists of the same class, those entries are visited together.
+    void buildPhase1Table()
+    {
+        phase1Prune.loadOrGenerate("twophase_phase1", (size_t)flipSliceSym.classCount() * TWIST_COUNT, [this](PruningTable& table)
+        {
+            const size_t solved = 0;
+            table.generate(&solved, 1, [this](size_t index, auto visit)
+            {
+                phase1Neighbours(index, visit);
+            });
+        });
+    }
+    template<class Visit>
+    void phase1Neighbours(size_t index, Visit visit) const
+    {
+        const int flipSlice = (int)flipSliceSym.representative[index / TWIST_COUNT], twist = (int)(index % TWIST_COUNT);
+        const int flip = flipSlice % FLIP_COUNT, slice = flipSlice / FLIP_COUNT * 24;
+        for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+        {
+            const int next = sliceSortedMove[slice * FACE_MOVE_COUNT + m] / 24 * FLIP_COUNT + flipMove[flip * FACE_MOVE_COUNT + m];
+            const size_t cls = flipSliceSym.classOf(next);
+            const int nextTwist = twistConjugate[twistMove[twist * FACE_MOVE_COUNT + m] * SYM_UD_COUNT + flipSliceSym.symOf(next)];
+            if (visit(cls * TWIST_COUNT + nextTwist))
+                return;
+            const uint64_t self = flipSliceSym.selfSymmetry[cls];
+            for (int s = 1; self > 1 && s < SYM_UD_COUNT; ++s)
+                if ((self >> s & 1) && visit(cls * TWIST_COUNT + twistConjugate[nextTwist * SYM_UD_COUNT + s]))
+                    return;
+        }
+    }
+
+    // state of one solve
+    struct Search
+    {
+        const TwoPhaseSolver& solver;
+        const CubieCube& cube;
+        // the same cube for replaying phase 1 solutions
+        const PackedCube packed;
+        int targetLength;
+        double timeLimit;
+        std::chrono::steady_clock::time_point start;
+        Result result;
+        int path[MAX_LENGTH];
+        int bestLength;
+        bool done;
+
+        Search(const TwoPhaseSolver& solver, const CubieCube& cube, int targetLength, double timeLimit)
+            : solver(solver), cube(cube), packed(cube), targetLength(targetLength), timeLimit(timeLimit), bestLength(MAX_LENGTH + 1), done(false) {}
+
+        double elapsed() const
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        void run()
+        {
+            start = std::chrono::steady_clock::now();
+            int twist = cube.twist(), flip = cube.flip(), slice = cube.sliceSorted();
+            const int distance = solver.phase1Distance(twist, flip, slice);
+            for (int depth = distance; depth < bestLength && !done; ++depth)
+                phase1(twist, flip, slice, distance, 0, depth, -1);
+            result.seconds = elapsed();
+        }
+
+        // distance is the exact phase 1 distance of the node
+        void phase1(int twist, int flip, int slice, int distance, int depth, int togo, int lastFace)
+        {
+            ++result.phase1Nodes;
+            if (togo == 0)
+            {
+                // a phase 1 solution ending with a phase 2 move was already tried one move shorter
+                if (depth == 0 || !isPhase2Move(path[depth - 1]))
+                    phase2Start(depth);
+                return;
+            }
+            // once a solution exists, check the clock now & then
+            if (bestLength <= MAX_LENGTH && (result.phase1Nodes & 0xfff) == 0 && elapsed() > timeLimit)
+                done = true;
+            for (int m = 0; m < FACE_MOVE_COUNT && !done; ++m)
+            {
+                if (skipFace(m / 3, lastFace))
+                    continue;
+                int nextTwist = solver.twistMove[twist * FACE_MOVE_COUNT + m];
+                int nextFlip = solver.flipMove[flip * FACE_MOVE_COUNT + m];
+                int nextSlice = solver.sliceSortedMove[slice * FACE_MOVE_COUNT + m];
+                const int nextDistance = Mod3PruningTable::distance(distance, solver.phase1Residue(nextTwist, nextFlip, nextSlice));
+                if (nextDistance >= togo)
+                    continue;
+                path[depth] = m;
+                phase1(nextTwist, nextFlip, nextSlice, nextDistance, depth + 1, togo - 1, m / 3);
+            }
+        }
+
+        void phase2Start(int length1)
+        {
+            PackedCube turned = packed;
+            turned.applyMoves(path, length1);
+            const CubieCube reached = turned.toCubie();
+            int corner = reached.cornerPerm(), edge = reached.udEdgePerm(), slice = reached.sliceSorted();
+            int bound = solver.phase2Bound(corner, edge, slice);
+            int lastFace = length1 > 0 ? path[length1 - 1] / 3 : -1;
+            for (int depth = bound; length1 + depth < bestLength && !done; ++depth)
+                if (phase2(corner, edge, slice, length1, depth, lastFace))
+                {
+                    bestLength = length1 + depth;
+                    result.found = true;
+                    result.phase1Length = length1;
+                    result.moves.assign(path, path + bestLength);
+                    if (bestLength <= targetLength || elapsed() > timeLimit)
+                        done = true;
+                    break;
+                }
+        }
+
+        bool phase2(int corner, int edge, int slice, int depth, int togo, int lastFace)
+        {
+            ++result.phase2Nodes;
+            if (togo == 0)
+                return corner == 0 && edge == 0 && slice == 0;
+            for (int i = 0; i < PHASE2_MOVE_COUNT; ++i)
+            {
+                int m = phase2Moves()[i];
+                if (skipFace(m / 3, lastFace))
+                    continue;
+                int nextCorner = solver.cornerPermMove[corner * FACE_MOVE_COUNT + m];
+                int nextEdge = solver.udEdgePermMove[edge * FACE_MOVE_COUNT + m];
+                int nextSlice = solver.sliceSortedMove[slice * FACE_MOVE_COUNT + m];
+                if (solver.phase2Bound(nextCorner, nextEdge, nextSlice) >= togo)
+                    continue;
+                path[depth] = m;
+                if (phase2(nextCorner, nextEdge, nextSlice, depth + 1, togo - 1, m / 3))
+                    return true;
+            }
+            return false;
+        }
+    };
+
+    size_t phase1Index(int twist, int flip, int slice) const
+    {
+        const uint32_t classSym = flipSliceSym.classSym[slice / 24 * FLIP_COUNT + flip];
+        return (size_t)(classSym >> 8) * TWIST_COUNT + twistConjugate[twist * SYM_UD_COUNT + (classSym & 0xff)];
+    }
+    int phase1Residue(int twist, int flip, int slice) const
+    {
+        return phase1Prune.get(phase1Index(twist, flip, slice));
+    }
+    // exact phase 1 distance of the start of a search, the search itself follows the residues
+    int phase1Distance(int twist, int flip, int slice) const
+    {
+        return phase1Prune.exactDistance(phase1Index(twist, flip, slice), 0, [this](size_t index, auto visit)
+        {
+            phase1Neighbours(index, visit);
+        });
+    }
+    // admissible lower bound of the remaining phase 2 moves
+    int phase2Bound(int corner, int edge, int slice) const
+    {
+        return std::max(cornerSlicePrune.get(slice * PERM_COUNT + corner), edgeSlicePrune.get(slice * PERM_COUNT + edge));
+    }
+};
+#endif
@@ -0,0 +1,145 @@
+#ifndef ZOBRIST_HASH_H
+#define ZOBRIST_HASH_H
+
+#include <cstdint>
+
+#include "cubeState.h"
+#include "cubieCube.h"
+
+// Zobrist hashing of cube states: the hash is the XOR of one pseudo-random 64-bit key per (position, piece,
+// orientation) the state holds. A move only changes the positions it moves, so the hash follows a move by XORing
+// the keys of those positions out before & in after it, 8 positions for a face move of the 3x3x3 cubie state &
+// the N * N slots of the turned slice for an NxNxN state, instead of rehashing every piece.
+// The keys are splitmix64 of the triple, the 480 keys of the 3x3x3 cubie state are kept in tables.
+class ZobristHash
+{
+public:
+    static uint64_t key(uint64_t position, uint64_t piece, uint64_t orientation)
+    {
+        return mix(position << 32 | piece << 8 | orientation);
+    }
+    // splitmix64 of x, also a hash of any state that fits into 64 bits
+    static uint64_t mix(uint64_t x)
+    {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ x >> 30) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ x >> 27) * 0x94D049BB133111EBull;
+        return x ^ x >> 31;
+    }
+
+    // 3x3x3 cubie states, corners at positions 0 - 7 & edges at 8 - 19. cube must be a proper cube (corner
+    // twists 0 - 2), not a reflection
+    // ----------------------------------------------------------------------------------------------------
+    static uint64_t of(const CubieCube& cube)
+    {
+        const Keys& keys = cubieKeys();
+        uint64_t hash = 0;
+        for (int i = 0; i < 8; ++i)
+            hash ^= keys.corner[i][cube.cp[i]][cube.co[i]];
+        for (int i = 0; i < 12; ++i)
+            hash ^= keys.edge[i][cube.ep[i]][cube.eo[i]];
+        return hash;
+    }
+    // hash of cube after face move m, cube still before it
+    static uint64_t afterMove(uint64_t hash, const CubieCube& cube, int m)
+    {
+        const Keys& keys = cubieKeys();
+        const CubieCube& move = CubieCube::move(m);
+        for (int k = 0; k < 4; ++k)
+        {
+            const int i = keys.movedCorner[m][k], from = move.cp[i];
+            hash ^= keys.corner[i][cube.cp[i]][cube.co[i]] ^ keys.corner[i][cube.cp[from]][(cube.co[from] + move.co[i]) % 3];
+        }
+        for (int k = 0; k < 4; ++k)
+        {
+            const int i = keys.movedEdge[m][k], from = move.ep[i];
+            hash ^= keys.edge[i][cube.ep[i]][cube.eo[i]] ^ keys.edge[i][cube.ep[from]][cube.eo[from] ^ move.eo[i]];
+        }
+        return hash;
+    }
+    // turn cube by face move m, returns its new hash
+    static uint64_t applyMove(CubieCube& cube, uint64_t hash, int m)
+    {
+        hash = afterMove(hash, cube, m);
+        cube.applyMove(m);
+        return hash;
+    }
+
+    // NxNxN states, Cube<N> or DynamicCube
+    // ------------------------------------
+    template<class CubeType>
+    static uint64_t of(const CubeType& cube)
+    {
+        uint64_t hash = 0;
+        for (int slot = 0; slot < cube.slotCount(); ++slot)
+            hash ^= key(slot, cube.cubie[slot], cube.orientation[slot]);
+        return hash;
+    }
+    // turn cube by move, returns its new hash
+    template<class CubeType>
+    static uint64_t applyMove(CubeType& cube, uint64_t hash, const CubeMove& move)
+    {
+        hash ^= sliceHash(cube, move);
+        cube.applyMove(move);
+        return hash ^ sliceHash(cube, move);
+    }
+
+private:
+    struct Keys
+    {
+        uint64_t corner[8][8][3];
+        uint64_t edge[12][12][2];
+        // the 4 corner & 4 edge positions each face move changes
+        uint8_t movedCorner[FACE_MOVE_COUNT][4];
+        uint8_t movedEdge[FACE_MOVE_COUNT][4];
+    };
+    static const Keys& cubieKeys()
+    {
+        static const struct Table : Keys
+        {
+            Table()
+            {
+                for (int i = 0; i < 8; ++i)
+                    for (int c = 0; c < 8; ++c)
+                        for (int o = 0; o < 3; ++o)
+                            corner[i][c][o] = key(i, c, o);
+                for (int i = 0; i < 12; ++i)
+                    for (int e = 0; e < 12; ++e)
+                        for (int o = 0; o < 2; ++o)
+                            edge[i][e][o] = key(8 + i, e, o);
+                for (int m = 0; m < FACE_MOVE_COUNT; ++m)
+                {
+                    const CubieCube& move = CubieCube::move(m);
+                    int corners = 0, edges = 0;
+                    for (int i = 0; i < 8; ++i)
+                        if (move.cp[i] != i)
+                            movedCorner[m][corners++] = (uint8_t)i;
+                    for (int i = 0; i < 12; ++i)
+                        if (move.ep[i] != i)
+                            movedEdge[m][edges++] = (uint8_t)i;
+                }
+            }
+        } table;
+        return table;
+    }
+
+    // keys of the slots of the slice move turns
+    template<class CubeType>
+    static uint64_t sliceHash(const CubeType& cube, const CubeMove& move)
+    {
+        const int n = cube.order();
+        int coord[3];
+        coord[move.axis] = move.slice;
+        uint64_t hash = 0;
+        for (int a = 0; a < n; ++a)
+            for (int b = 0; b < n; ++b)
+            {
+                coord[(move.axis + 1) % 3] = a;
+                coord[(move.axis + 2) % 3] = b;
+                const int slot = cube.slotIndex(coord[AXIS_X], coord[AXIS_Y], coord[AXIS_Z]);
+                hash ^= key(slot, cube.cubie[slot], cube.orientation[slot]);
+            }
+        return hash;
+    }
+};
+#endif